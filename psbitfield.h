@@ -7,6 +7,23 @@
 #include <limits>
 #include <cassert>
 #include <ostream>
+#include <atomic>
+#include <cstring>
+#include <cstddef>
+#ifdef __has_include
+#if __has_include(<bit>)
+#include <bit>
+#endif
+#endif
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+#ifdef PSBF_COUNT_ACCESSES
+#include "psbitfield_counts.h"
+#endif
+#ifdef PSBF_TRACE_ACCESSES
+#include "psbitfield_trace.h"
+#endif
 
 
 // this is a bitfield implementation to be used within unions for device registers
@@ -42,21 +59,321 @@
 
 namespace psbf {
 
-template<uint8_t from, uint8_t width, typename UINT=uint32_t>
+enum class byteorder {
+	little,
+	big,
+#if defined(__cpp_lib_endian)
+	native = std::endian::native == std::endian::big ? big : little
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	native = big
+#else
+	native = little
+#endif
+};
+
+namespace detail {
+template<typename UINT>
+constexpr UINT byteswap(UINT word){
+	static_assert(std::is_unsigned_v<UINT>);
+#if defined(__GNUC__) || defined(__clang__)
+	if constexpr (sizeof(UINT) == 8) return __builtin_bswap64(word);
+	else if constexpr (sizeof(UINT) == 4) return __builtin_bswap32(word);
+	else if constexpr (sizeof(UINT) == 2) return __builtin_bswap16(word);
+	else return word;
+#else
+	UINT result{};
+	for (std::size_t i=0; i < sizeof(UINT); ++i){
+		result = UINT((result << CHAR_BIT) | ((word >> (i*CHAR_BIT)) & 0xffu));
+	}
+	return result;
+#endif
+}
+// convert between host order and order
+template<byteorder order, typename UINT>
+constexpr UINT convert(UINT word){
+	if constexpr (order == byteorder::native) return word;
+	else return byteswap(word);
+}
+}
+
+// access policies define how a word is stored and accessed:
+// encode converts a word from host representation into its stored representation, decode vice versa.
+// load and store perform the single read or write of a volatile word, non-volatile words are accessed directly.
+struct native_access {
+	template<typename UINT>
+	static constexpr UINT encode(UINT word) { return word; }
+	template<typename UINT>
+	static constexpr UINT decode(UINT word) { return word; }
+	template<typename UINT>
+	static UINT load(UINT const volatile &word) { return word; }
+	template<typename UINT>
+	static void store(UINT volatile &word, UINT newword) { word = newword; }
+};
+// the word is stored in the given byte order, e.g., a big-endian device register or packet
+template<byteorder order>
+struct byteorder_access : native_access {
+	template<typename UINT>
+	static constexpr UINT encode(UINT word) { return detail::convert<order>(word); }
+	template<typename UINT>
+	static constexpr UINT decode(UINT word) { return detail::convert<order>(word); }
+};
+
+// volatile words in ordinary memory accessed as non-volatile, e.g., to run register layouts
+// on a host build, the compiler may combine and eliminate accesses. Not for device registers!
+template<typename BASE=native_access>
+struct plain_access : BASE {
+	template<typename UINT>
+	static UINT load(UINT const volatile &word) { return const_cast<UINT const &>(word); }
+	template<typename UINT>
+	static void store(UINT volatile &word, UINT newword) { const_cast<UINT &>(word) = newword; }
+};
+
+#if defined(__cpp_lib_atomic_ref)
+// words shared with other threads or processes accessed as std::atomic_ref, so that the compiler may schedule
+// accesses as the memory order allows, while they are atomic for the CPU. The union must not be volatile,
+// std::atomic_ref cannot refer to volatile objects, and should name the policy (using access = ...),
+// so that snapshot and whole-word accesses are atomic as well.
+// Reads use order (relaxed for release), writes use order (relaxed for acquire). Changing fields is a
+// single atomic read-modify-write (update, a compare-exchange loop), writes of other fields of the word are not lost.
+// set(), clear(), toggle() and test_and_set() of one-bit fields are a single fetch_or, fetch_and or fetch_xor.
+template<std::memory_order order, typename BASE=native_access>
+struct atomic_access : BASE {
+	static_assert(order != std::memory_order_consume, "use acquire");
+	static constexpr inline std::memory_order loadorder =
+			order == std::memory_order_release ? std::memory_order_relaxed :
+			order == std::memory_order_acq_rel ? std::memory_order_acquire : order;
+	static constexpr inline std::memory_order storeorder =
+			order == std::memory_order_acquire ? std::memory_order_relaxed :
+			order == std::memory_order_acq_rel ? std::memory_order_release : order;
+	template<typename UINT>
+	static UINT load(UINT const &word) { return atomic(const_cast<UINT &>(word)).load(loadorder); }
+	template<typename UINT>
+	static void store(UINT &word, UINT newword) { atomic(word).store(newword, storeorder); }
+	// word = change(word), returns the previous word
+	template<typename UINT, typename CHANGE>
+	static UINT update(UINT &word, CHANGE change) {
+		auto shared = atomic(word);
+		UINT old = shared.load(loadorder);
+		while (! shared.compare_exchange_weak(old, change(old), order, loadorder)) {}
+		return old;
+	}
+	// word |= bits, word &= bits, word ^= bits, return the previous word
+	template<typename UINT>
+	static UINT fetch_or(UINT &word, UINT bits) { return atomic(word).fetch_or(bits, order); }
+	template<typename UINT>
+	static UINT fetch_and(UINT &word, UINT bits) { return atomic(word).fetch_and(bits, order); }
+	template<typename UINT>
+	static UINT fetch_xor(UINT &word, UINT bits) { return atomic(word).fetch_xor(bits, order); }
+private:
+	template<typename UINT>
+	static auto atomic(UINT &word) {
+		static_assert(! std::is_volatile_v<UINT>, "atomic_access cannot access volatile words, declare the union non-volatile");
+		static_assert(std::atomic_ref<UINT>::is_always_lock_free, "shared words must be lock free");
+		static_assert(alignof(UINT) >= std::atomic_ref<UINT>::required_alignment);
+		return std::atomic_ref<UINT>{word};
+	}
+};
+using relaxed_access = atomic_access<std::memory_order_relaxed>;
+using acquire_access = atomic_access<std::memory_order_acquire>;
+using release_access = atomic_access<std::memory_order_release>;
+using acq_rel_access = atomic_access<std::memory_order_acq_rel>;
+using seq_cst_access = atomic_access<std::memory_order_seq_cst>;
+#endif
+
+// enumerations are stored as unsigned values, even with a signed underlying type, e.g., int of an
+// enum class without one. Specialize for enumerations with negative values to store them sign-extended:
+//	template<> struct psbf::signed_enum<Level> : std::true_type {};
+template<typename ENUM>
+struct signed_enum : std::false_type {};
+
+namespace detail {
+// count an access of the bits of BF in word, if PSBF_COUNT_ACCESSES is defined
+template<typename BF>
+void count(void const volatile *word, bool write) {
+#ifdef PSBF_COUNT_ACCESSES
+	count_access(word, BF::wordsize, uint64_t(BF::mask), write);
+#else
+	(void) word; (void) write;
+#endif
+}
+// record an access of word, if PSBF_TRACE_ACCESSES is defined
+template<typename UINT>
+void trace(UINT const volatile *word, uint64_t mask, UINT value, bool write) {
+#ifdef PSBF_TRACE_ACCESSES
+	trace_access(word, sizeof(UINT), mask, value, write);
+#else
+	(void) word; (void) mask; (void) value; (void) write;
+#endif
+}
+
+// count and trace an access of word for the given fields
+template<typename ...FIELDS, typename UINT>
+void record(UINT const volatile *word, UINT value, bool write) {
+	(count<FIELDS>(word, write), ...);
+	trace(word, (uint64_t{} | ... | uint64_t(FIELDS::storedmask)), value, write);
+}
+
+// ACCESS provides update for a single atomic read-modify-write of WORD, e.g., atomic_access for non-volatile words
+template<typename ACCESS, typename WORD, typename = void>
+struct has_update : std::false_type {};
+template<typename ACCESS, typename WORD>
+struct has_update<ACCESS, WORD, std::void_t<decltype(ACCESS::update(std::declval<WORD &>(),
+		std::declval<std::remove_volatile_t<WORD>(*)(std::remove_volatile_t<WORD>)>()))>>
+: std::true_type {};
+
+// a word read or written for the given fields: through the access policy, counted and traced,
+// if it is volatile or the policy provides update for non-volatile words, e.g., atomic_access
+template<typename ACCESS, typename ...FIELDS, typename UINT>
+UINT load(UINT const volatile &word) {
+	UINT const value = ACCESS::load(word);
+	record<FIELDS...>(&word, value, false);
+	return value;
+}
+template<typename ACCESS, typename ...FIELDS, typename UINT>
+constexpr UINT load(UINT const &word) {
+	if constexpr (has_update<ACCESS, UINT>::value) {
+		UINT const value = ACCESS::load(word);
+		record<FIELDS...>(&word, value, false);
+		return value;
+	} else {
+		return word;
+	}
+}
+template<typename ACCESS, typename ...FIELDS, typename UINT>
+void store(UINT volatile &word, UINT newword) {
+	record<FIELDS...>(&word, newword, true);
+	ACCESS::store(word, newword);
+}
+template<typename ACCESS, typename ...FIELDS, typename UINT>
+constexpr void store(UINT &word, UINT newword) {
+	if constexpr (has_update<ACCESS, UINT>::value) {
+		record<FIELDS...>(&word, newword, true);
+		ACCESS::store(word, newword);
+	} else {
+		word = newword;
+	}
+}
+
+// word = change(word) for the given fields, returns the previous word:
+// ACCESS::update, if the policy provides it, otherwise a read and a write
+template<typename ACCESS, typename ...FIELDS, typename UINT, typename CHANGE>
+UINT update(UINT volatile &word, CHANGE change) {
+	if constexpr (has_update<ACCESS, UINT volatile>::value) {
+		UINT const old = ACCESS::update(word, change);
+		record<FIELDS...>(&word, old, false);
+		record<FIELDS...>(&word, UINT(change(old)), true);
+		return old;
+	} else {
+		UINT const old = load<ACCESS,FIELDS...>(word);
+		store<ACCESS,FIELDS...>(word, UINT(change(old)));
+		return old;
+	}
+}
+template<typename ACCESS, typename ...FIELDS, typename UINT, typename CHANGE>
+constexpr UINT update(UINT &word, CHANGE change) {
+	if constexpr (has_update<ACCESS, UINT>::value) {
+		UINT const old = ACCESS::update(word, change);
+		record<FIELDS...>(&word, old, false);
+		record<FIELDS...>(&word, UINT(change(old)), true);
+		return old;
+	} else {
+		UINT const old = word;
+		word = UINT(change(old));
+		return old;
+	}
+}
+
+// ACCESS provides fetch_or, fetch_and and fetch_xor for changing bits of WORD in a single step, e.g., atomic_access
+template<typename ACCESS, typename WORD, typename = void>
+struct has_fetch : std::false_type {};
+template<typename ACCESS, typename WORD>
+struct has_fetch<ACCESS, WORD, std::void_t<
+		decltype(ACCESS::fetch_or(std::declval<WORD &>(), std::remove_volatile_t<WORD>{})),
+		decltype(ACCESS::fetch_and(std::declval<WORD &>(), std::remove_volatile_t<WORD>{})),
+		decltype(ACCESS::fetch_xor(std::declval<WORD &>(), std::remove_volatile_t<WORD>{}))>>
+: std::true_type {};
+
+// word |= bits, word &= bits or word ^= bits for the given fields, returns the previous word:
+// ACCESS::fetch_or, fetch_and or fetch_xor, if the policy provides them, otherwise update
+template<typename ACCESS, typename ...FIELDS, typename WORD, typename UINT = std::remove_volatile_t<WORD>>
+constexpr UINT fetch_or(WORD &word, std::remove_volatile_t<WORD> bits) {
+	if constexpr (has_fetch<ACCESS, WORD>::value) {
+		UINT const old = ACCESS::fetch_or(word, bits);
+		record<FIELDS...>(&word, old, false);
+		record<FIELDS...>(&word, UINT(old | bits), true);
+		return old;
+	} else {
+		return update<ACCESS,FIELDS...>(word, [bits](UINT old){ return UINT(old | bits); });
+	}
+}
+template<typename ACCESS, typename ...FIELDS, typename WORD, typename UINT = std::remove_volatile_t<WORD>>
+constexpr UINT fetch_and(WORD &word, std::remove_volatile_t<WORD> bits) {
+	if constexpr (has_fetch<ACCESS, WORD>::value) {
+		UINT const old = ACCESS::fetch_and(word, bits);
+		record<FIELDS...>(&word, old, false);
+		record<FIELDS...>(&word, UINT(old & bits), true);
+		return old;
+	} else {
+		return update<ACCESS,FIELDS...>(word, [bits](UINT old){ return UINT(old & bits); });
+	}
+}
+template<typename ACCESS, typename ...FIELDS, typename WORD, typename UINT = std::remove_volatile_t<WORD>>
+constexpr UINT fetch_xor(WORD &word, std::remove_volatile_t<WORD> bits) {
+	if constexpr (has_fetch<ACCESS, WORD>::value) {
+		UINT const old = ACCESS::fetch_xor(word, bits);
+		record<FIELDS...>(&word, old, false);
+		record<FIELDS...>(&word, UINT(old ^ bits), true);
+		return old;
+	} else {
+		return update<ACCESS,FIELDS...>(word, [bits](UINT old){ return UINT(old ^ bits); });
+	}
+}
+
+template<typename INT, bool = std::is_signed_v<INT>>
+struct unsigned_of { using type = INT; };
+template<typename INT>
+struct unsigned_of<INT, true> { using type = std::make_unsigned_t<INT>; };
+
+// the integer type representing values of VALUE, unsigned for enumerations unless declared signed_enum
+template<typename VALUE, bool = std::is_enum_v<VALUE>>
+struct number_of { using type = VALUE; };
+template<typename VALUE>
+struct number_of<VALUE, true> {
+	using type = std::conditional_t<signed_enum<VALUE>::value,
+			std::underlying_type_t<VALUE>, typename unsigned_of<std::underlying_type_t<VALUE>>::type>;
+};
+}
+
+// VALUE is the type of the field's value: an integer type, an enumeration or bool (one-bit fields only).
+// Signed fields hold two's complement values of width bits, reading sign-extends with a shift-left/arithmetic-shift-right pair.
+template<uint8_t from, uint8_t width, typename UINT=uint32_t, typename ACCESS=native_access, typename VALUE=std::remove_volatile_t<UINT>>
 struct bitfield{
 	using result_type = std::remove_volatile_t<UINT>;
+	using value_type = VALUE;
+	using number_type = typename detail::number_of<VALUE>::type;
+	using access = ACCESS;
 	using as_volatile = std::conditional_t<std::is_volatile_v<UINT>,UINT,UINT volatile>;
 	using expr_type = std::conditional_t<sizeof(result_type)<=sizeof(unsigned),unsigned,result_type >;
 	static_assert(std::numeric_limits<UINT>::is_integer && ! std::numeric_limits<UINT>::is_signed, "must use unsigned bitfield base type");
 	static_assert(std::numeric_limits<UINT>::digits == sizeof(UINT)*CHAR_BIT);
+	static_assert(std::is_integral_v<number_type>, "value type must be an integer, enumeration or bool");
+	static_assert(! std::is_same_v<number_type,bool> || width == 1, "bool fields must be one bit wide");
+	static_assert(std::numeric_limits<number_type>::digits + std::is_signed_v<number_type> >= width, "value type too narrow for bitfield");
 	static constexpr inline uint8_t wordsize = sizeof(UINT)*CHAR_BIT;
+	static constexpr inline uint8_t lsb = from;
+	static constexpr inline uint8_t bitwidth = width;
 	static constexpr inline expr_type widthmask = (width == wordsize)?result_type(-1):(result_type(1)<<width)-1;
 	static constexpr inline expr_type mask = (result_type(-1) >> (wordsize-width)) << from; // we have two's complement!
+	// mask of the field in the stored representation of the word
+	static constexpr inline expr_type storedmask = ACCESS::encode(result_type(mask));
 	static_assert(widthmask ==  (mask>>from) );
 	static_assert((width==wordsize?result_type(-1):(result_type(1u)<<width)-result_type(1u))==(from > 0? mask>>from: mask));
 	static_assert(from < wordsize, "starting position too big");
 	static_assert(from+width <= wordsize, "bitfield too wide");
 	static_assert(width>0, "zero-size bitfields not supported");
+	// range of values
+	static constexpr inline value_type maxvalue = value_type(number_type(std::is_signed_v<number_type>? widthmask>>1 : widthmask));
+	static constexpr inline value_type minvalue = value_type(std::is_signed_v<number_type>? number_type(~(widthmask>>1)) : number_type{});
 	as_volatile& allbitsvolatileforwrite() volatile & {
 		return const_cast<as_volatile&>(allbits);
 	}
@@ -64,26 +381,395 @@ struct bitfield{
 		return const_cast<as_volatile const&>(allbits);
 	}
 
-	operator result_type() const volatile { return (expr_type(allbitsvolatileforread()) & mask) >> from;}
+	operator value_type() const volatile { return value_of(ACCESS::decode(load()));}
 	constexpr
-	operator result_type() const  { return (expr_type(allbits) & mask) >> from;}
+	operator value_type() const  { return value_of(ACCESS::decode(detail::load<ACCESS,bitfield>(allbits)));}
 
-	void operator=(result_type newval) volatile & { // don't support chaining!
+	// word-level helpers, e.g., for combining several fields in a single access
+	static constexpr result_type extract(result_type word) { return (expr_type(word) & mask) >> from;}
+	static constexpr expr_type place(result_type newval) {
 		assert(0==(newval& ~widthmask));
-		allbitsvolatileforwrite() = UINT((expr_type(allbitsvolatileforread()) & ~mask ) | ((expr_type(newval)&widthmask)<<from));
+		return (expr_type(newval)&widthmask)<<from;
 	}
-	constexpr void operator=(result_type newval)  & { // don't support chaining!
-		assert(0==(newval& ~widthmask));
-		allbits = UINT((expr_type(allbits) & ~mask) | ((expr_type(newval)&widthmask)<<from));
+	// the value of the field in word, signed values are sign-extended
+	static constexpr value_type value_of(result_type word) {
+		if constexpr (std::is_same_v<value_type, bool>) {
+			return (expr_type(word) & mask) != 0;
+		} else if constexpr (std::is_signed_v<number_type>) {
+			constexpr uint8_t exprsize = std::numeric_limits<expr_type>::digits;
+			using signed_expr = std::make_signed_t<expr_type>;
+			return value_type(number_type(signed_expr(expr_type(word) << (exprsize-from-width)) >> (exprsize-width)));
+		} else {
+			return value_type(number_type(extract(word)));
+		}
+	}
+	// the bits of the field representing newval, not yet placed
+	static constexpr result_type bits_of(value_type newval) {
+		assert(newval >= minvalue && newval <= maxvalue);
+		return result_type(result_type(number_type(newval)) & widthmask);
+	}
+
+	// the stored representation of the field with value newval, the rest of the word is zero
+	static constexpr expr_type stored(value_type newval) { return ACCESS::encode(result_type(place(bits_of(newval))));}
+
+	// a field of the whole word is written without reading it,
+	// a one-bit field with a single fetch_or or fetch_and, if ACCESS provides them
+	void operator=(value_type newval) volatile & { // don't support chaining!
+		if constexpr (width == wordsize) {
+			store(result_type(stored(newval)));
+		} else if constexpr (width == 1 && detail::has_fetch<ACCESS, as_volatile>::value) {
+			if (stored(newval)) detail::fetch_or<ACCESS,bitfield>(allbitsvolatileforwrite(), result_type(storedmask));
+			else detail::fetch_and<ACCESS,bitfield>(allbitsvolatileforwrite(), result_type(~storedmask));
+		} else {
+			expr_type const bits = stored(newval);
+			update([bits](result_type word){ return result_type((expr_type(word) & ~storedmask) | bits); });
+		}
+	}
+	constexpr void operator=(value_type newval)  & { // don't support chaining!
+		if constexpr (width == wordsize) {
+			detail::store<ACCESS,bitfield>(allbits, result_type(stored(newval)));
+		} else if constexpr (width == 1 && detail::has_fetch<ACCESS, UINT>::value) {
+			if (stored(newval)) detail::fetch_or<ACCESS,bitfield>(allbits, result_type(storedmask));
+			else detail::fetch_and<ACCESS,bitfield>(allbits, result_type(~storedmask));
+		} else {
+			expr_type const bits = stored(newval);
+			detail::update<ACCESS,bitfield>(allbits, [bits](result_type word){ return result_type((expr_type(word) & ~storedmask) | bits); });
+		}
+	}
+	// single-bit fields only, a single fetch_or, fetch_and or fetch_xor, if ACCESS provides them:
+	void set() volatile & { static_assert(width==1, "only for one-bit fields");
+		detail::fetch_or<ACCESS,bitfield>(allbitsvolatileforwrite(), result_type(storedmask));
+	}
+	constexpr void set() & { static_assert(width==1, "only for one-bit fields");
+		detail::fetch_or<ACCESS,bitfield>(allbits, result_type(storedmask));
+	}
+	void clear() volatile & { static_assert(width==1, "only for one-bit fields");
+		detail::fetch_and<ACCESS,bitfield>(allbitsvolatileforwrite(), result_type(~storedmask));
+	}
+	constexpr void clear() & { static_assert(width==1, "only for one-bit fields");
+		detail::fetch_and<ACCESS,bitfield>(allbits, result_type(~storedmask));
+	}
+	void toggle() volatile & { static_assert(width==1, "only for one-bit fields");
+		detail::fetch_xor<ACCESS,bitfield>(allbitsvolatileforwrite(), result_type(storedmask));
+	}
+	constexpr void toggle() & { static_assert(width==1, "only for one-bit fields");
+		detail::fetch_xor<ACCESS,bitfield>(allbits, result_type(storedmask));
+	}
+	bool test_and_set() volatile & { static_assert(width==1, "only for one-bit fields");
+		expr_type const old = detail::fetch_or<ACCESS,bitfield>(allbitsvolatileforwrite(), result_type(storedmask));
+		return old & storedmask;
+	}
+	constexpr bool test_and_set() & { static_assert(width==1, "only for one-bit fields");
+		expr_type const old = detail::fetch_or<ACCESS,bitfield>(allbits, result_type(storedmask));
+		return old & storedmask;
 	}
 	// prevent copying as bitfield struct and thus surrounding union:
 	bitfield& operator=(bitfield&&) & noexcept = delete;
+private:
+	// the single read or write of the word
+	result_type load() const volatile {
+		return detail::load<ACCESS,bitfield>(allbitsvolatileforread());
+	}
+	void store(result_type newword) volatile {
+		detail::store<ACCESS,bitfield>(allbitsvolatileforwrite(), newword);
+	}
+	// the single read-modify-write of the word, returns the previous word
+	template<typename CHANGE>
+	result_type update(CHANGE change) volatile {
+		return detail::update<ACCESS,bitfield>(allbitsvolatileforwrite(), change);
+	}
+public:
 	UINT  allbits;
 };
 
 namespace detail{
-template<typename UINT=uint32_t>
-using allbits=bitfield<0,std::numeric_limits<UINT>::digits,UINT>;
+template<typename UINT=uint32_t, typename ACCESS=native_access>
+using allbits=bitfield<0,std::numeric_limits<UINT>::digits,UINT,ACCESS>;
+
+template<typename FROM, typename TO>
+using copy_cv_t = std::conditional_t<std::is_const_v<FROM>,
+		std::conditional_t<std::is_volatile_v<FROM>, TO const volatile, TO const>,
+		std::conditional_t<std::is_volatile_v<FROM>, TO volatile, TO>>;
+
+template<std::size_t bytes> struct word_for_size;
+template<> struct word_for_size<1> { using type = uint8_t; };
+template<> struct word_for_size<2> { using type = uint16_t; };
+template<> struct word_for_size<4> { using type = uint32_t; };
+template<> struct word_for_size<8> { using type = uint64_t; };
+
+template<typename MEMBERPTR> struct member_of;
+template<typename BF, typename UNION>
+struct member_of<BF UNION::*> { using type = BF; using union_type = UNION; };
+template<auto member>
+using field_t = typename member_of<decltype(member)>::type;
+
+// access the word of a union through its member of type BF (common initial sequence)
+template<typename BF, typename UNION>
+auto& wordof(UNION &reg){
+	static_assert(std::is_union_v<std::remove_cv_t<UNION>>, "bitfields must be accessed through their union");
+	static_assert(sizeof(UNION) == sizeof(typename BF::result_type), "bitfield does not match union size");
+	return reinterpret_cast<copy_cv_t<UNION,BF>&>(reg).allbits;
+}
+
+// the access policy of a union's word, given by a member type access of the union, e.g.,
+//	template<typename ACCESS> union MyReg { using access = ACCESS; psbf::bitfield<0,32,uint32_t,ACCESS> word; ... };
+template<typename UNION, typename = void>
+struct access_of { using type = native_access; };
+template<typename UNION>
+struct access_of<UNION, std::void_t<typename UNION::access>> { using type = typename UNION::access; };
+template<typename UNION, typename = void>
+struct declares_access : std::false_type {};
+template<typename UNION>
+struct declares_access<UNION, std::void_t<typename UNION::access>> : std::true_type {};
+
+// BF can be a field of UNION: it accesses a word of the union's size and the union's access policy, if it names one
+template<typename UNION, typename BF>
+constexpr bool field_of() {
+	using union_type = std::remove_cv_t<UNION>;
+	if constexpr (! std::is_union_v<union_type> || sizeof(union_type) != sizeof(typename BF::result_type)) return false;
+	else if constexpr (declares_access<union_type>::value) return std::is_same_v<typename union_type::access, typename BF::access>;
+	else return true;
+}
+// bits belonging to more than one of masks
+template<typename EXPR, typename ...MASKS>
+constexpr EXPR overlap_of(MASKS ...masks) {
+	EXPR seen{}, overlap{};
+	((overlap |= EXPR(seen & EXPR(masks)), seen |= EXPR(masks)), ...);
+	return overlap;
+}
+
+// read or write the whole word of a union
+template<typename UNION>
+auto loadword(UNION &reg){
+	using result_type = typename word_for_size<sizeof(UNION)>::type;
+	return load<typename access_of<std::remove_cv_t<UNION>>::type, allbits<result_type>>(wordof<allbits<result_type>>(reg));
+}
+template<typename UNION>
+void storeword(UNION &reg, typename word_for_size<sizeof(UNION)>::type newword){
+	using result_type = typename word_for_size<sizeof(UNION)>::type;
+	store<typename access_of<std::remove_cv_t<UNION>>::type, allbits<result_type>>(wordof<allbits<result_type>>(reg), newword);
+}
+}
+
+// a value split across several slices of the same word, the first slice holds the least significant bits:
+//	union MyReg32 {
+//		psbf::allbits32 word;
+//		psbf::scattered<psbf::bits32<0,8>, psbf::bits32<24,4>> value; // 12 bits
+//	};
+// with BMI2 and slices at ascending positions, reading is a single pext and writing a single pdep
+template<typename SLICE, typename ...SLICES>
+struct scattered {
+	using result_type = typename SLICE::result_type;
+	using value_type = result_type;
+	using expr_type = typename SLICE::expr_type;
+	using access = typename SLICE::access;
+	static_assert((std::is_same_v<result_type, typename SLICES::result_type> && ...), "all slices must share the same word");
+	static_assert((std::is_same_v<access, typename SLICES::access> && ...), "all slices must share the same access");
+	static constexpr inline uint8_t wordsize = SLICE::wordsize;
+	static constexpr inline uint8_t bitwidth = uint8_t(SLICE::bitwidth + (SLICES::bitwidth + ... + 0));
+	static constexpr inline expr_type mask = (SLICE::mask | ... | SLICES::mask);
+	static constexpr inline expr_type storedmask = access::encode(result_type(mask));
+	static constexpr inline expr_type widthmask = (bitwidth == wordsize)?result_type(-1):(result_type(1)<<bitwidth)-1;
+	static_assert(bitwidth <= wordsize, "slices too wide");
+private:
+	static constexpr unsigned popcount(expr_type bits) {
+		unsigned count = 0;
+		for (; bits != 0; bits &= bits - 1) ++count;
+		return count;
+	}
+	static_assert(popcount(mask) == bitwidth, "slices overlap");
+	static constexpr bool ascending() {
+		uint8_t const positions[]{SLICE::lsb, SLICES::lsb...};
+		for (std::size_t i=1; i < sizeof(positions); ++i){
+			if (positions[i] <= positions[i-1]) return false;
+		}
+		return true;
+	}
+	static constexpr bool constant_evaluated() {
+#if defined(__cpp_lib_is_constant_evaluated)
+		return std::is_constant_evaluated();
+#elif defined(__GNUC__) || defined(__clang__)
+		return __builtin_is_constant_evaluated();
+#else
+		return true; // cannot tell, never use pext/pdep
+#endif
+	}
+public:
+	static constexpr result_type extract(result_type word) {
+#ifdef __BMI2__
+		if constexpr (ascending()) {
+			if (! constant_evaluated()) {
+				if constexpr (sizeof(result_type) == 8) return _pext_u64(word, mask);
+				else return result_type(_pext_u32(word, mask));
+			}
+		}
+#endif
+		expr_type value = SLICE::extract(word);
+		unsigned offset = SLICE::bitwidth;
+		((value |= expr_type(SLICES::extract(word)) << offset, offset += SLICES::bitwidth), ...);
+		return result_type(value);
+	}
+	static constexpr expr_type place(result_type newval) {
+		assert(0==(newval& ~widthmask));
+#ifdef __BMI2__
+		if constexpr (ascending()) {
+			if (! constant_evaluated()) {
+				if constexpr (sizeof(result_type) == 8) return _pdep_u64(newval, mask);
+				else return _pdep_u32(newval, expr_type(mask));
+			}
+		}
+#endif
+		expr_type bits = SLICE::place(result_type(newval & SLICE::widthmask));
+		unsigned offset = SLICE::bitwidth;
+		((bits |= SLICES::place(result_type((expr_type(newval) >> offset) & SLICES::widthmask)), offset += SLICES::bitwidth), ...);
+		return bits;
+	}
+
+	static constexpr value_type value_of(result_type word) { return extract(word); }
+	static constexpr result_type bits_of(value_type newval) { return newval; }
+	static constexpr expr_type stored(result_type newval) { return access::encode(result_type(place(newval)));}
+
+	operator result_type() const volatile { return extract(access::decode(detail::load<access,scattered>(allbits)));}
+	constexpr
+	operator result_type() const  { return extract(access::decode(detail::load<access,scattered>(allbits)));}
+
+	void operator=(result_type newval) volatile & { // don't support chaining!
+		expr_type const bits = stored(newval);
+		detail::update<access,scattered>(allbits, [bits](result_type word){ return result_type((expr_type(word) & ~storedmask) | bits); });
+	}
+	constexpr void operator=(result_type newval)  & { // don't support chaining!
+		expr_type const bits = stored(newval);
+		detail::update<access,scattered>(allbits, [bits](result_type word){ return result_type((expr_type(word) & ~storedmask) | bits); });
+	}
+	// prevent copying as bitfield struct and thus surrounding union:
+	scattered& operator=(scattered&&) & noexcept = delete;
+	result_type allbits;
+};
+
+// a fixed-point number in a bitfield with fracbits fraction bits, e.g., Q4.12 in a signed 16-bit field:
+//	union Sensor {
+//		psbf::allbits16 word;
+//		psbf::fixedpoint<psbf::sbits16<0,16>,12> temperature;
+//	};
+// reads and assignments use REAL, converting is a multiplication by a constant power of two,
+// assignments round to the nearest representable value. raw() reads and writes the bits of the field.
+template<typename FIELD, uint8_t fracbits, typename REAL=float>
+struct fixedpoint {
+	using field = FIELD;
+	using result_type = typename FIELD::result_type;
+	using value_type = REAL;
+	using raw_type = typename FIELD::value_type;
+	using expr_type = typename FIELD::expr_type;
+	using access = typename FIELD::access;
+	static_assert(std::is_floating_point_v<REAL>, "fixed-point values convert to a floating-point type");
+	static_assert(std::is_integral_v<raw_type> && ! std::is_same_v<raw_type,bool>, "fixed-point values need an integer field");
+	static_assert(fracbits < 64, "too many fraction bits");
+	static constexpr inline uint8_t wordsize = FIELD::wordsize;
+	static constexpr inline uint8_t lsb = FIELD::lsb;
+	static constexpr inline uint8_t bitwidth = FIELD::bitwidth;
+	static constexpr inline expr_type widthmask = FIELD::widthmask;
+	static constexpr inline expr_type mask = FIELD::mask;
+	static constexpr inline expr_type storedmask = FIELD::storedmask;
+	// the value of the least significant bit
+	static constexpr inline REAL resolution = REAL(1) / REAL(uint64_t{1} << fracbits);
+
+	static constexpr REAL to_real(raw_type raw) { return REAL(raw) * resolution; }
+	static constexpr raw_type to_raw(REAL newval) {
+		REAL const scaled = newval * REAL(uint64_t{1} << fracbits);
+		assert(scaled > REAL(FIELD::minvalue) - REAL(0.5) && scaled < REAL(FIELD::maxvalue) + REAL(0.5));
+		return raw_type(scaled < REAL(0) ? scaled - REAL(0.5) : scaled + REAL(0.5));
+	}
+
+	static constexpr result_type extract(result_type word) { return FIELD::extract(word); }
+	static constexpr expr_type place(result_type newval) { return FIELD::place(newval); }
+	static constexpr value_type value_of(result_type word) { return to_real(FIELD::value_of(word)); }
+	static constexpr result_type bits_of(value_type newval) { return FIELD::bits_of(to_raw(newval)); }
+	static constexpr expr_type stored(value_type newval) { return FIELD::stored(to_raw(newval)); }
+
+	raw_type raw() const volatile { return FIELD::value_of(access::decode(detail::load<access,fixedpoint>(allbits)));}
+	constexpr raw_type raw() const { return FIELD::value_of(access::decode(detail::load<access,fixedpoint>(allbits)));}
+	void raw(raw_type newraw) volatile & {
+		expr_type const bits = FIELD::stored(newraw);
+		detail::update<access,fixedpoint>(allbits, [bits](result_type word){ return result_type((expr_type(word) & ~storedmask) | bits); });
+	}
+	constexpr void raw(raw_type newraw) & {
+		expr_type const bits = FIELD::stored(newraw);
+		detail::update<access,fixedpoint>(allbits, [bits](result_type word){ return result_type((expr_type(word) & ~storedmask) | bits); });
+	}
+
+	operator value_type() const volatile { return to_real(raw());}
+	constexpr
+	operator value_type() const  { return to_real(raw());}
+
+	void operator=(value_type newval) volatile & { // don't support chaining!
+		raw(to_raw(newval));
+	}
+	constexpr void operator=(value_type newval)  & { // don't support chaining!
+		raw(to_raw(newval));
+	}
+	// prevent copying as bitfield struct and thus surrounding union:
+	fixedpoint& operator=(fixedpoint&&) & noexcept = delete;
+	result_type allbits;
+};
+
+// a field and its new value, for updating several fields at once
+template<typename BF>
+struct fieldvalue {
+	using field_type = BF;
+	typename BF::value_type value;
+	// the field given to value(), if any, for checking that it is set in its own union
+	void const volatile *field{};
+};
+
+template<uint8_t from, uint8_t width, typename UINT, typename ACCESS, typename VALUE>
+constexpr fieldvalue<bitfield<from,width,UINT,ACCESS,VALUE>>
+value(bitfield<from,width,UINT,ACCESS,VALUE> const volatile &field, typename bitfield<from,width,UINT,ACCESS,VALUE>::value_type newval){
+	assert(newval >= (bitfield<from,width,UINT,ACCESS,VALUE>::minvalue) && newval <= (bitfield<from,width,UINT,ACCESS,VALUE>::maxvalue));
+	return {newval, &field};
+}
+
+template<typename SLICE, typename ...SLICES>
+constexpr fieldvalue<scattered<SLICE,SLICES...>>
+value(scattered<SLICE,SLICES...> const volatile &field, typename scattered<SLICE,SLICES...>::value_type newval){
+	assert(0 == (newval & ~scattered<SLICE,SLICES...>::widthmask));
+	return {newval, &field};
+}
+
+template<typename FIELD, uint8_t fracbits, typename REAL>
+constexpr fieldvalue<fixedpoint<FIELD,fracbits,REAL>>
+value(fixedpoint<FIELD,fracbits,REAL> const volatile &field, typename fixedpoint<FIELD,fracbits,REAL>::value_type newval){
+	return {newval, &field};
+}
+
+namespace detail {
+// the value was not given for a field of another object than reg, all members of a union have its address
+template<typename UNION, typename BF>
+constexpr bool given_for(UNION const volatile &reg, fieldvalue<BF> const &fv) {
+	return fv.field == nullptr || fv.field == static_cast<void const volatile *>(&reg);
+}
+}
+
+// set several fields of reg with a single read and a single write of the word:
+//	psbf::modify(var, psbf::value(var.firstnibble, 3), psbf::value(var.threebits, 5));
+// if the fields cover the whole word, it is written without reading it.
+// The fields must not overlap and must be fields of reg, not of another register.
+template<typename UNION, typename BF, typename ...BFS>
+void modify(UNION &reg, fieldvalue<BF> first, fieldvalue<BFS> ...rest){
+	static_assert((std::is_same_v<typename BF::result_type, typename BFS::result_type> && ...), "all fields must share the same word");
+	static_assert(detail::field_of<UNION,BF>() && (detail::field_of<UNION,BFS>() && ...), "field is not a member of union");
+	using result_type = typename BF::result_type;
+	using expr_type = typename BF::expr_type;
+	static_assert(detail::overlap_of<expr_type>(BF::storedmask, BFS::storedmask...) == 0, "fields overlap or are given twice");
+	assert(detail::given_for(reg, first) && (detail::given_for(reg, rest) && ...));
+	constexpr expr_type storedmask = (BF::storedmask | ... | BFS::storedmask);
+	using access = typename BF::access;
+	auto &word = detail::wordof<BF>(reg);
+	if constexpr (storedmask == detail::allbits<result_type>::mask) {
+		detail::store<access,BF,BFS...>(word, result_type(BF::stored(first.value) | (expr_type{} | ... | BFS::stored(rest.value))));
+	} else {
+		expr_type const bits = BF::stored(first.value) | (expr_type{} | ... | BFS::stored(rest.value));
+		detail::update<access,BF,BFS...>(word, [bits](result_type old){ return result_type((expr_type(old) & ~storedmask) | bits); });
+	}
 }
 
 // for use as first union member
@@ -101,6 +787,309 @@ using bits32 = bitfield<from,width,uint32_t>;
 template<uint8_t from, uint8_t width>
 using bits64 = bitfield<from,width,uint64_t>;
 
+// words stored in big-endian or little-endian byte order, regardless of the host
+using allbits64_be = detail::allbits<uint64_t, byteorder_access<byteorder::big>>;
+using allbits32_be = detail::allbits<uint32_t, byteorder_access<byteorder::big>>;
+using allbits16_be = detail::allbits<uint16_t, byteorder_access<byteorder::big>>;
+using allbits64_le = detail::allbits<uint64_t, byteorder_access<byteorder::little>>;
+using allbits32_le = detail::allbits<uint32_t, byteorder_access<byteorder::little>>;
+using allbits16_le = detail::allbits<uint16_t, byteorder_access<byteorder::little>>;
+
+template<uint8_t from, uint8_t width>
+using bits16_be = bitfield<from,width,uint16_t,byteorder_access<byteorder::big>>;
+template<uint8_t from, uint8_t width>
+using bits32_be = bitfield<from,width,uint32_t,byteorder_access<byteorder::big>>;
+template<uint8_t from, uint8_t width>
+using bits64_be = bitfield<from,width,uint64_t,byteorder_access<byteorder::big>>;
+template<uint8_t from, uint8_t width>
+using bits16_le = bitfield<from,width,uint16_t,byteorder_access<byteorder::little>>;
+template<uint8_t from, uint8_t width>
+using bits32_le = bitfield<from,width,uint32_t,byteorder_access<byteorder::little>>;
+template<uint8_t from, uint8_t width>
+using bits64_le = bitfield<from,width,uint64_t,byteorder_access<byteorder::little>>;
+
+// signed fields, two's complement within width bits
+template<uint8_t from, uint8_t width>
+using sbits8 = bitfield<from,width,uint8_t,native_access,int8_t>;
+template<uint8_t from, uint8_t width>
+using sbits16 = bitfield<from,width,uint16_t,native_access,int16_t>;
+template<uint8_t from, uint8_t width>
+using sbits32 = bitfield<from,width,uint32_t,native_access,int32_t>;
+template<uint8_t from, uint8_t width>
+using sbits64 = bitfield<from,width,uint64_t,native_access,int64_t>;
+
+// fields of an enumeration type, e.g., enum class Mode : uint8_t { off, slow, fast };
+template<uint8_t from, uint8_t width, typename ENUM>
+using enumbits8 = bitfield<from,width,uint8_t,native_access,ENUM>;
+template<uint8_t from, uint8_t width, typename ENUM>
+using enumbits16 = bitfield<from,width,uint16_t,native_access,ENUM>;
+template<uint8_t from, uint8_t width, typename ENUM>
+using enumbits32 = bitfield<from,width,uint32_t,native_access,ENUM>;
+template<uint8_t from, uint8_t width, typename ENUM>
+using enumbits64 = bitfield<from,width,uint64_t,native_access,ENUM>;
+
+// one-bit fields read as bool
+template<uint8_t bit>
+using flag8 = bitfield<bit,1,uint8_t,native_access,bool>;
+template<uint8_t bit>
+using flag16 = bitfield<bit,1,uint16_t,native_access,bool>;
+template<uint8_t bit>
+using flag32 = bitfield<bit,1,uint32_t,native_access,bool>;
+template<uint8_t bit>
+using flag64 = bitfield<bit,1,uint64_t,native_access,bool>;
+
+// read the word of a register once and return a non-volatile copy to extract several fields from:
+//	auto const status = psbf::snapshot(var);
+//	unsigned const low = status.firstnibble, high = status.secondbyte;
+// requires a bitfield member as the first member of the union, e.g., psbf::allbits16
+template<typename UNION>
+UNION snapshot(UNION const volatile &reg){
+	return UNION{{detail::loadword(reg)}};
+}
+// a union shared between threads, e.g., with atomic_access, is read with a single atomic load
+template<typename UNION>
+UNION snapshot(UNION const &reg){
+	return UNION{{detail::loadword(reg)}};
+}
+
+// build a register value from fields without reading the register, then store it with a single write:
+//	constexpr auto ctrl = psbf::compose<MyReg16>{}.set<&MyReg16::firstnibble>(3).set<&MyReg16::threebits>(5);
+//	ctrl.store(var);
+// bits not set keep the initial value given to the constructor, e.g., a known reset value.
+template<typename UNION>
+class compose {
+	static_assert(std::is_union_v<UNION>, "compose a union of bitfields");
+public:
+	using result_type = typename detail::word_for_size<sizeof(UNION)>::type;
+	constexpr explicit compose(result_type initial = 0):bits{initial}{}
+
+	template<typename BF>
+	constexpr compose set(fieldvalue<BF> fv) const {
+		static_assert(detail::field_of<UNION,BF>(), "field is not a member of union");
+		using expr_type = typename BF::expr_type;
+		return compose(result_type((expr_type(bits) & ~BF::storedmask) | BF::stored(fv.value)));
+	}
+	template<auto member>
+	constexpr compose set(typename detail::field_t<member>::value_type newval) const {
+		static_assert(std::is_same_v<typename detail::member_of<decltype(member)>::union_type, UNION>, "field is not a member of union");
+		return set(fieldvalue<detail::field_t<member>>{newval});
+	}
+	// the word as stored, i.e., encoded by the fields' access policies
+	constexpr result_type value() const { return bits; }
+
+	void store(UNION volatile &reg) const {
+		detail::storeword(reg, bits);
+	}
+	void store(UNION &reg) const {
+		detail::storeword(reg, bits);
+	}
+private:
+	result_type bits;
+};
+
+// the fields of a union, checked at compile time to share the same word and not to overlap.
+// List the fields without the allbits member and without alternative views of the same bits:
+//	using CtrlLayout = psbf::layout<decltype(Ctrl::mode), decltype(Ctrl::enable), decltype(Ctrl::divider)>;
+//	static_assert(CtrlLayout::reserved_mask == 0xffff'ff00u);
+//	CtrlLayout::store(ctrl, psbf::value(ctrl.mode, 2), psbf::value(ctrl.enable, 1), psbf::value(ctrl.divider, 7));
+// store() sets all fields with a single write without reading the register. Reserved bits are written as zero
+// or, given as second argument, with the bits of a stored word, e.g., the reset value:
+//	CtrlLayout::store(ctrl, ctrl_reset, psbf::value(ctrl.mode, 2), psbf::value(ctrl.enable, 1), psbf::value(ctrl.divider, 7));
+template<typename FIELD, typename ...FIELDS>
+struct layout {
+	using result_type = typename FIELD::result_type;
+	using expr_type = typename FIELD::expr_type;
+	using access = typename FIELD::access;
+	static_assert((std::is_same_v<result_type, typename FIELDS::result_type> && ...), "all fields must share the same word");
+	static_assert((std::is_same_v<access, typename FIELDS::access> && ...), "all fields must share the same access");
+private:
+	template<typename BF>
+	static constexpr bool listed = (std::is_same_v<BF,FIELD> || ... || std::is_same_v<BF,FIELDS>);
+public:
+	// bits belonging to more than one field
+	static constexpr inline expr_type overlap_mask = detail::overlap_of<expr_type>(FIELD::mask, FIELDS::mask...);
+	static_assert(overlap_mask == 0, "fields overlap");
+	static constexpr inline expr_type all_fields_mask = (FIELD::mask | ... | FIELDS::mask);
+	// bits not covered by any field
+	static constexpr inline expr_type reserved_mask = detail::allbits<result_type>::mask & ~all_fields_mask;
+	static constexpr inline bool complete = reserved_mask == 0;
+
+	// reserved_mask in the stored representation of the word
+	static constexpr inline expr_type stored_reserved_mask = access::encode(result_type(reserved_mask));
+
+	// the stored word with all fields set to the given values and the reserved bits as in reserved (a stored word),
+	// e.g., the register's reset value, or zero
+	template<typename ...BFS>
+	static constexpr result_type word(result_type reserved, fieldvalue<BFS> ...values) {
+		static_assert((listed<BFS> && ...), "field is not part of the layout");
+		static_assert(detail::overlap_of<expr_type>(BFS::mask...) == 0, "field given twice");
+		static_assert((expr_type{} | ... | BFS::mask) == all_fields_mask, "all fields of the layout must be given");
+		return result_type((expr_type(reserved) & stored_reserved_mask) | (expr_type{} | ... | BFS::stored(values.value)));
+	}
+	template<typename ...BFS>
+	static constexpr result_type word(fieldvalue<BFS> ...values) {
+		return word(result_type{}, values...);
+	}
+	template<typename UNION, typename ...BFS>
+	static void store(UNION &reg, result_type reserved, fieldvalue<BFS> ...values) {
+		static_assert(detail::field_of<UNION,FIELD>() && (detail::field_of<UNION,FIELDS>() && ...), "layout does not match union");
+		assert((detail::given_for(reg, values) && ...));
+		detail::store<access,detail::allbits<result_type>>(detail::wordof<detail::allbits<result_type,access>>(reg), word(reserved, values...));
+	}
+	template<typename UNION, typename ...BFS>
+	static void store(UNION &reg, fieldvalue<BFS> ...values) {
+		store(reg, result_type{}, values...);
+	}
+	// the reserved bits of word are zero
+	static constexpr bool valid(result_type bits) {
+		return 0 == (expr_type(access::decode(bits)) & reserved_mask);
+	}
+};
+
+// keeps a non-volatile copy of a register, setting fields only changes the copy
+// and flush() writes it back with a single write, if any field was set:
+//	psbf::shadowed<MyReg16> shadow{var}; // reads var once
+//	shadow.set<&MyReg16::firstnibble>(3);
+//	shadow.set(psbf::value(shadow->threebits, 5));
+//	unsigned const x = shadow->secondbyte; // from the copy
+//	shadow.flush();
+// the destructor does not flush.
+template<typename UNION>
+class shadowed {
+	static_assert(std::is_union_v<UNION>, "shadow a union of bitfields");
+public:
+	using result_type = typename detail::word_for_size<sizeof(UNION)>::type;
+	explicit shadowed(UNION volatile &reg):reg{reg},copy{snapshot(reg)}{}
+	// do not read the register, start from a known value, e.g., its reset value
+	shadowed(UNION volatile &reg, result_type initial):reg{reg},copy{{initial}}{}
+
+	UNION const & operator*() const { return copy; }
+	UNION const * operator->() const { return &copy; }
+
+	// the value may be given for a field of the copy or of the register
+	template<typename BF>
+	void set(fieldvalue<BF> fv) {
+		static_assert(detail::field_of<UNION,BF>(), "field is not a member of union");
+		assert(detail::given_for(reg, fv) || detail::given_for(copy, fv));
+		fv.field = nullptr;
+		modify(copy, fv);
+		dirtymask = result_type(dirtymask | BF::mask);
+	}
+	template<auto member>
+	void set(typename detail::field_t<member>::value_type newval) {
+		static_assert(std::is_same_v<typename detail::member_of<decltype(member)>::union_type, UNION>, "field is not a member of union");
+		set(fieldvalue<detail::field_t<member>>{newval});
+	}
+	// the bits of all fields set since the last write
+	result_type dirty() const { return dirtymask; }
+
+	bool flush() {
+		if (dirtymask == 0) return false;
+		write();
+		return true;
+	}
+	void write() {
+		detail::storeword(reg, detail::loadword(copy));
+		dirtymask = 0;
+	}
+	// discard the copy and read the register again
+	void reload() {
+		detail::storeword(copy, detail::loadword(reg));
+		dirtymask = 0;
+	}
+private:
+	UNION volatile &reg;
+	UNION copy;
+	result_type dirtymask{};
+};
+
+// applies the layout of a union of bitfields to a word at an arbitrary (unaligned) position
+// in a byte buffer, e.g., a packet header, stored in the given byte order:
+//	psbf::wire_view<MyHeader32, psbf::byteorder::big> header{packet + 14};
+//	unsigned const length = header.get<&MyHeader32::length>();
+//	header.set<&MyHeader32::ttl>(64);
+//	auto const copy = header.load(); // a MyHeader32
+// each access is a single unaligned load or store of the word, plus a byte swap if needed.
+// use BYTE = std::byte const for read-only buffers
+template<typename UNION, byteorder order = byteorder::native, typename BYTE = std::byte>
+class wire_view {
+	static_assert(std::is_union_v<UNION>, "view a union of bitfields");
+	static_assert(sizeof(BYTE) == 1, "view a buffer of bytes");
+public:
+	using result_type = typename detail::word_for_size<sizeof(UNION)>::type;
+	explicit wire_view(BYTE *position):position{position}{}
+
+	result_type word() const {
+		result_type word;
+		std::memcpy(&word, position, sizeof(word));
+		return detail::convert<order>(word);
+	}
+	UNION load() const {
+		return UNION{{word()}};
+	}
+	template<auto member>
+	typename detail::field_t<member>::value_type get() const {
+		static_assert(std::is_same_v<typename detail::member_of<decltype(member)>::union_type, UNION>, "field is not a member of union");
+		static_assert(std::is_same_v<native_access, typename detail::field_t<member>::access>, "the byte order is given by the view");
+		return detail::field_t<member>::value_of(word());
+	}
+
+	void store(result_type newword) const {
+		static_assert(! std::is_const_v<BYTE>, "buffer is read-only");
+		newword = detail::convert<order>(newword);
+		std::memcpy(position, &newword, sizeof(newword));
+	}
+	void store(UNION const &value) const {
+		store(detail::wordof<detail::allbits<result_type>>(value));
+	}
+	template<auto member>
+	void set(typename detail::field_t<member>::value_type newval) const {
+		static_assert(std::is_same_v<typename detail::member_of<decltype(member)>::union_type, UNION>, "field is not a member of union");
+		modify(fieldvalue<detail::field_t<member>>{newval});
+	}
+	// set several fields with a single load and store
+	template<typename ...BFS>
+	void modify(fieldvalue<BFS> ...vals) const {
+		static_assert((std::is_same_v<result_type, typename BFS::result_type> && ...), "fields do not match union");
+		static_assert((std::is_same_v<native_access, typename BFS::access> && ...), "the byte order is given by the view");
+		using expr_type = typename detail::allbits<result_type>::expr_type;
+		static_assert(detail::overlap_of<expr_type>(BFS::mask...) == 0, "fields overlap or are given twice");
+		constexpr expr_type mask = (expr_type{} | ... | BFS::mask);
+		store(result_type((expr_type(word()) & ~mask) | (expr_type{} | ... | BFS::place(BFS::bits_of(vals.value)))));
+	}
+private:
+	BYTE *position;
+};
+
+#ifdef __cpp_lib_atomic_ref
+// bitfields of words shared between threads, accessed through atomic_access with the given policy, e.g.,
+//	union Shared {
+//		using access = psbf::seq_cst_access;
+//		psbf::atomic_allbits32 word;
+//		psbf::atomic_bits32<0,1> flag;
+//		psbf::atomic_bits32<1,15> counter;
+//	};
+// assigning a field is a compare-exchange loop, set(), clear(), toggle() and test_and_set() a single
+// fetch_or, fetch_and or fetch_xor. The union must not be volatile.
+template<uint8_t from, uint8_t width, typename UINT=uint32_t, typename ACCESS=seq_cst_access>
+using atomic_bitfield = bitfield<from,width,UINT,ACCESS>;
+
+// for use as first union member
+using atomic_allbits64 = detail::allbits<uint64_t,seq_cst_access>;
+using atomic_allbits32 = detail::allbits<uint32_t,seq_cst_access>;
+using atomic_allbits16 = detail::allbits<uint16_t,seq_cst_access>;
+using atomic_allbits8  = detail::allbits<uint8_t,seq_cst_access>;
+
+template<uint8_t from, uint8_t width, typename ACCESS=seq_cst_access>
+using atomic_bits8 = bitfield<from,width,uint8_t,ACCESS>;
+template<uint8_t from, uint8_t width, typename ACCESS=seq_cst_access>
+using atomic_bits16 = bitfield<from,width,uint16_t,ACCESS>;
+template<uint8_t from, uint8_t width, typename ACCESS=seq_cst_access>
+using atomic_bits32 = bitfield<from,width,uint32_t,ACCESS>;
+template<uint8_t from, uint8_t width, typename ACCESS=seq_cst_access>
+using atomic_bits64 = bitfield<from,width,uint64_t,ACCESS>;
+#endif
+
 }
 
 
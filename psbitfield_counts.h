@@ -0,0 +1,180 @@
+#ifndef PSBITFIELD_COUNTS_H_
+#define PSBITFIELD_COUNTS_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// counting volatile accesses per register and field, to find the accesses worth batching or shadowing.
+// Define PSBF_COUNT_ACCESSES for the whole program (all translation units!) to count the volatile
+// reads and writes of bitfields, modify, snapshot and the other whole-word helpers of psbitfield.h.
+// Each thread counts in its own table, merged when the thread ends.
+// At exit the counts are printed to stderr, most accesses first:
+//
+//	     reads     writes  register            bits
+//	    120000          3  0x7f3c2a001008 32   [0,4)
+//	        10          0  0x7f3c2a001008 32   0x0f000f00
+//
+// Registers are identified by the address of their word, fields by their bits: a range of bits,
+// or the mask for fields whose bits are not contiguous, e.g., psbf::scattered. Whole-word accesses count for all bits.
+
+
+namespace psbf {
+
+struct access_count {
+	void const volatile *word;
+	unsigned wordsize;
+	uint64_t mask; // the bits of the field(s) accessed
+	uint64_t reads;
+	uint64_t writes;
+
+	// the lowest bit of the field
+	unsigned from() const {
+		if (mask == 0) return 0;
+#if defined(__GNUC__) || defined(__clang__)
+		return unsigned(__builtin_ctzll(mask));
+#else
+		unsigned bit = 0;
+		while (((mask >> bit) & 1u) == 0) ++bit;
+		return bit;
+#endif
+	}
+	// bits from the lowest to the highest bit of the field
+	unsigned width() const {
+		if (mask == 0) return 0;
+#if defined(__GNUC__) || defined(__clang__)
+		return 64u - unsigned(__builtin_clzll(mask)) - from();
+#else
+		unsigned end = 64;
+		while (((mask >> (end - 1)) & 1u) == 0) --end;
+		return end - from();
+#endif
+	}
+	bool contiguous() const {
+#if defined(__GNUC__) || defined(__clang__)
+		unsigned const bits = unsigned(__builtin_popcountll(mask));
+#else
+		unsigned bits = 0;
+		for (uint64_t rest = mask; rest != 0; rest &= rest - 1) ++bits;
+#endif
+		return bits == width();
+	}
+};
+
+namespace detail {
+struct access_key {
+	void const volatile *word;
+	uint8_t wordsize;
+	uint64_t mask;
+	friend bool operator==(access_key const &l, access_key const &r) {
+		return l.word == r.word && l.wordsize == r.wordsize && l.mask == r.mask;
+	}
+};
+struct access_key_hash {
+	std::size_t operator()(access_key const &key) const {
+		return std::hash<std::uintptr_t>{}(reinterpret_cast<std::uintptr_t>(key.word)) ^ std::hash<uint64_t>{}(key.mask);
+	}
+};
+struct access_tally { uint64_t reads{}, writes{}; };
+using access_table = std::unordered_map<access_key, access_tally, access_key_hash>;
+
+inline void merge(access_table &into, access_table const &from) {
+	for (auto const &[key, tally] : from) {
+		auto &total = into[key];
+		total.reads += tally.reads;
+		total.writes += tally.writes;
+	}
+}
+inline std::vector<access_count> sorted(access_table const &table) {
+	std::vector<access_count> counts{};
+	counts.reserve(table.size());
+	for (auto const &[key, tally] : table) {
+		counts.push_back({key.word, key.wordsize, key.mask, tally.reads, tally.writes});
+	}
+	std::sort(counts.begin(), counts.end(), [](access_count const &l, access_count const &r){
+		return l.reads + l.writes > r.reads + r.writes;
+	});
+	return counts;
+}
+inline void print(std::FILE *out, std::vector<access_count> const &counts) {
+	std::fprintf(out, "%10s %10s  %-18s %-3s bits\n", "reads", "writes", "register", "");
+	for (auto const &count : counts) {
+		std::fprintf(out, "%10llu %10llu  %-18p %-3u ",
+				static_cast<unsigned long long>(count.reads), static_cast<unsigned long long>(count.writes),
+				const_cast<void const *>(count.word), count.wordsize);
+		if (count.contiguous()) std::fprintf(out, "[%u,%u)\n", count.from(), count.from() + count.width());
+		else std::fprintf(out, "0x%0*llx\n", int(count.wordsize / 4), static_cast<unsigned long long>(count.mask));
+	}
+}
+
+// the counts of ended threads, printed at exit
+class access_report {
+public:
+	static access_report & instance() {
+		static access_report report{};
+		return report;
+	}
+	void add(access_table const &table) {
+		std::lock_guard<std::mutex> lock{mutex};
+		merge(totals, table);
+	}
+	access_table table() {
+		std::lock_guard<std::mutex> lock{mutex};
+		return totals;
+	}
+	void clear() {
+		std::lock_guard<std::mutex> lock{mutex};
+		totals.clear();
+	}
+	~access_report() {
+		if (! totals.empty()) {
+			std::fprintf(stderr, "psbf access counts:\n");
+			print(stderr, sorted(totals));
+		}
+	}
+private:
+	access_report() = default;
+	std::mutex mutex{};
+	access_table totals{};
+};
+
+struct thread_access_table {
+	// constructing the report first ensures it is destroyed, i.e., printed, after the tables of all threads
+	thread_access_table() { access_report::instance(); }
+	~thread_access_table() { access_report::instance().add(table); }
+	access_table table{};
+};
+inline access_table & thread_accesses() {
+	thread_local thread_access_table accesses{};
+	return accesses.table;
+}
+
+inline void count_access(void const volatile *word, uint8_t wordsize, uint64_t mask, bool write) {
+	auto &tally = thread_accesses()[access_key{word, wordsize, mask}];
+	++(write ? tally.writes : tally.reads);
+}
+}
+
+// the counts of ended threads and of the calling thread, most accesses first
+inline std::vector<access_count> access_counts() {
+	auto table = detail::access_report::instance().table();
+	detail::merge(table, detail::thread_accesses());
+	return detail::sorted(table);
+}
+inline void print_access_counts(std::FILE *out) {
+	detail::print(out, access_counts());
+}
+// forget the counts of ended threads and of the calling thread
+inline void reset_access_counts() {
+	detail::access_report::instance().clear();
+	detail::thread_accesses().clear();
+}
+
+}
+
+#endif /* PSBITFIELD_COUNTS_H_ */
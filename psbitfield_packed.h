@@ -0,0 +1,181 @@
+#ifndef PSBITFIELD_PACKED_H_
+#define PSBITFIELD_PACKED_H_
+
+#include "psbitfield.h"
+
+#include <cstddef>
+#include <iterator>
+#include <numeric>
+#include <vector>
+
+// a sequence of width-bit unsigned values stored densely in words of type UINT,
+// values may straddle word boundaries. Masks are the ones of psbf::bitfield<0,width,UINT>.
+//
+// Usage:
+//
+//	psbf::packed_vector<12> samples(1'000'000); // 12 bits each, in uint64_t words
+//	samples[42] = 0xABC;
+//	unsigned const x = samples[42];
+//	samples.fill(0x555);
+
+
+namespace psbf {
+
+template<uint8_t width, typename UINT=uint64_t>
+class packed_vector {
+	using field = bitfield<0,width,UINT>;
+	using expr_type = typename field::expr_type;
+	static_assert(! std::is_volatile_v<UINT>, "packed_vector is not for device registers");
+	static constexpr inline std::size_t wordsize = field::wordsize;
+	static constexpr std::size_t words_for(std::size_t n) { return (n * width + wordsize - 1) / wordsize; }
+public:
+	using value_type = typename field::result_type;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+
+	class reference {
+		friend class packed_vector;
+		reference(packed_vector &v, size_type i):v{v},i{i}{}
+		packed_vector &v;
+		size_type i;
+	public:
+		operator value_type() const { return v.get(i); }
+		reference& operator=(value_type newval) { v.set(i, newval); return *this; }
+		reference& operator=(reference const &other) { v.set(i, other); return *this; }
+		friend void swap(reference l, reference r) {
+			value_type const tmp = l;
+			l = r;
+			r = tmp;
+		}
+	};
+
+	template<bool is_const>
+	class basic_iterator {
+		using container = std::conditional_t<is_const, packed_vector const, packed_vector>;
+		friend class packed_vector;
+		basic_iterator(container *v, size_type i):v{v},i{i}{}
+		container *v{};
+		size_type i{};
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = packed_vector::value_type;
+		using difference_type = packed_vector::difference_type;
+		using reference = std::conditional_t<is_const, value_type, packed_vector::reference>;
+		using pointer = void;
+		basic_iterator() = default;
+		operator basic_iterator<true>() const { return {v, i}; }
+
+		reference operator*() const { return (*v)[i]; }
+		reference operator[](difference_type n) const { return (*v)[size_type(difference_type(i) + n)]; }
+		basic_iterator& operator++() { ++i; return *this; }
+		basic_iterator operator++(int) { auto old = *this; ++i; return old; }
+		basic_iterator& operator--() { --i; return *this; }
+		basic_iterator operator--(int) { auto old = *this; --i; return old; }
+		basic_iterator& operator+=(difference_type n) { i = size_type(difference_type(i) + n); return *this; }
+		basic_iterator& operator-=(difference_type n) { i = size_type(difference_type(i) - n); return *this; }
+		friend basic_iterator operator+(basic_iterator it, difference_type n) { return it += n; }
+		friend basic_iterator operator+(difference_type n, basic_iterator it) { return it += n; }
+		friend basic_iterator operator-(basic_iterator it, difference_type n) { return it -= n; }
+		friend difference_type operator-(basic_iterator const &l, basic_iterator const &r) { return difference_type(l.i) - difference_type(r.i); }
+		friend bool operator==(basic_iterator const &l, basic_iterator const &r) { return l.i == r.i; }
+		friend bool operator!=(basic_iterator const &l, basic_iterator const &r) { return l.i != r.i; }
+		friend bool operator<(basic_iterator const &l, basic_iterator const &r) { return l.i < r.i; }
+		friend bool operator>(basic_iterator const &l, basic_iterator const &r) { return l.i > r.i; }
+		friend bool operator<=(basic_iterator const &l, basic_iterator const &r) { return l.i <= r.i; }
+		friend bool operator>=(basic_iterator const &l, basic_iterator const &r) { return l.i >= r.i; }
+	};
+	using iterator = basic_iterator<false>;
+	using const_iterator = basic_iterator<true>;
+
+	packed_vector() = default;
+	explicit packed_vector(size_type n, value_type initial = 0)
+	:words(words_for(n)),count{n}{
+		if (initial != 0) fill(initial);
+	}
+
+	size_type size() const { return count; }
+	bool empty() const { return count == 0; }
+	// the packed words, unused bits of the last word are zero
+	UINT const * data() const { return words.data(); }
+	size_type word_count() const { return words.size(); }
+
+	value_type get(size_type i) const {
+		assert(i < count);
+		size_type const bit = i * width;
+		size_type const index = bit / wordsize;
+		auto const shift = unsigned(bit % wordsize);
+		expr_type bits = expr_type(words[index]) >> shift;
+		if (shift + width > wordsize) {
+			bits |= expr_type(words[index + 1]) << (wordsize - shift);
+		}
+		return value_type(bits & field::widthmask);
+	}
+	void set(size_type i, value_type newval) {
+		assert(i < count);
+		expr_type const bits = field::place(newval);
+		size_type const bit = i * width;
+		size_type const index = bit / wordsize;
+		auto const shift = unsigned(bit % wordsize);
+		words[index] = UINT((expr_type(words[index]) & ~(field::widthmask << shift)) | (bits << shift));
+		if (shift + width > wordsize) {
+			auto const spill = unsigned(wordsize - shift);
+			words[index + 1] = UINT((expr_type(words[index + 1]) & ~(field::widthmask >> spill)) | (bits >> spill));
+		}
+	}
+	value_type operator[](size_type i) const { return get(i); }
+	reference operator[](size_type i) { return {*this, i}; }
+
+	void push_back(value_type newval) {
+		resize(count + 1);
+		set(count - 1, newval);
+	}
+	void resize(size_type n) {
+		words.resize(words_for(n));
+		count = n;
+		clear_unused();
+	}
+	// set all values, writing whole words of a precomputed repeating pattern
+	void fill(value_type newval) {
+		expr_type const bits = field::place(newval);
+		constexpr size_type period = width / std::gcd(size_type{width}, wordsize); // words
+		UINT pattern[period]{};
+		for (size_type bit = 0; bit < period * wordsize; bit += width) {
+			size_type const index = bit / wordsize;
+			auto const shift = unsigned(bit % wordsize);
+			pattern[index] = UINT(expr_type(pattern[index]) | (bits << shift));
+			if (shift + width > wordsize) {
+				pattern[index + 1] = UINT(expr_type(pattern[index + 1]) | (bits >> (wordsize - shift)));
+			}
+		}
+		for (size_type index = 0; index < words.size(); ++index) {
+			words[index] = pattern[index % period];
+		}
+		clear_unused();
+	}
+
+	iterator begin() { return {this, 0}; }
+	iterator end() { return {this, count}; }
+	const_iterator begin() const { return {this, 0}; }
+	const_iterator end() const { return {this, count}; }
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+
+	friend bool operator==(packed_vector const &l, packed_vector const &r) {
+		return l.count == r.count && l.words == r.words;
+	}
+	friend bool operator!=(packed_vector const &l, packed_vector const &r) {
+		return !(l == r);
+	}
+private:
+	void clear_unused() {
+		if (auto const used = unsigned(count * width % wordsize); used != 0) {
+			words.back() = UINT(expr_type(words.back()) & ((expr_type(1) << used) - 1));
+		}
+	}
+	std::vector<UINT> words;
+	size_type count{};
+};
+
+}
+
+#endif /* PSBITFIELD_PACKED_H_ */
@@ -0,0 +1,143 @@
+#ifndef PSBITFIELD_REGMAP_H_
+#define PSBITFIELD_REGMAP_H_
+
+#include "psbitfield.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <tuple>
+#include <utility>
+
+// a block of device registers, each a union of bitfields at a fixed byte offset from a base address.
+// Saving and restoring the whole block accesses each register once with its own word size
+// in the order given, while a saved image is plain memory that can be copied and compared in bulk.
+//
+// Usage:
+//
+//	using MyDevice = psbf::register_block<
+//		psbf::reg_at<0x0, CtrlReg32>,
+//		psbf::reg_at<0x4, ModeReg16>,
+//		psbf::reg_at<0x8, DataReg64>>;
+//	MyDevice dev{reinterpret_cast<void volatile *>(0x4000'1000)};
+//	dev.get<1>().fourthbit = 1;
+//	MyDevice::image saved{};
+//	dev.save(saved);    // suspend
+//	dev.restore(saved); // resume
+
+
+namespace psbf {
+
+template<std::size_t offset, typename UNION>
+struct reg_at {
+	static_assert(std::is_union_v<UNION>, "registers must be unions of bitfields");
+	static_assert(offset % sizeof(UNION) == 0, "register must be naturally aligned");
+	using type = UNION;
+	using result_type = typename detail::word_for_size<sizeof(UNION)>::type;
+	static constexpr inline std::size_t position = offset;
+	static constexpr inline std::size_t end = offset + sizeof(UNION);
+};
+
+template<typename ...REGS>
+class register_block {
+	static_assert(sizeof...(REGS) > 0, "empty register block");
+	using registers = std::tuple<REGS...>;
+	template<std::size_t I>
+	using reg = std::tuple_element_t<I,registers>;
+	static constexpr bool ascending() {
+		std::size_t const positions[]{REGS::position...};
+		std::size_t const ends[]{REGS::end...};
+		for (std::size_t i=1; i < sizeof...(REGS); ++i){
+			if (positions[i] < ends[i-1]) return false;
+		}
+		return true;
+	}
+	static_assert(ascending(), "registers must be given in ascending order without overlap");
+public:
+	static constexpr inline std::size_t size = std::max({REGS::end...});
+	// non-volatile copy of all registers, value-initialize it, so that gaps between registers compare equal
+	struct image {
+		alignas(8) std::array<std::byte, size> bytes;
+		friend bool operator==(image const &l, image const &r){
+			return std::memcmp(l.bytes.data(), r.bytes.data(), size) == 0;
+		}
+		friend bool operator!=(image const &l, image const &r){
+			return !(l == r);
+		}
+	};
+
+	explicit register_block(void volatile *base)
+	:base{static_cast<std::byte volatile *>(base)}{}
+
+	template<std::size_t I>
+	typename reg<I>::type volatile & get() const {
+		return *reinterpret_cast<typename reg<I>::type volatile *>(base + reg<I>::position);
+	}
+
+	// read all registers in order
+	void save(image &img) const {
+		save(img, std::index_sequence_for<REGS...>{});
+	}
+	// write all registers in order
+	void restore(image const &img) {
+		restore(img, std::index_sequence_for<REGS...>{});
+	}
+	// write only registers that differ between img and current, e.g., a previously saved image,
+	// returns the number of registers written
+	std::size_t restore_changed(image const &img, image const &current) {
+		return restore_changed(img, current, std::index_sequence_for<REGS...>{});
+	}
+	// read all registers in order and compare them with img
+	bool matches(image const &img) const {
+		return matches(img, std::index_sequence_for<REGS...>{});
+	}
+private:
+	template<std::size_t I>
+	typename reg<I>::result_type load() const {
+		return detail::loadword(get<I>());
+	}
+	template<std::size_t I>
+	void store(typename reg<I>::result_type word) {
+		detail::storeword(get<I>(), word);
+	}
+	template<std::size_t I>
+	static typename reg<I>::result_type from(image const &img) {
+		typename reg<I>::result_type word;
+		std::memcpy(&word, img.bytes.data() + reg<I>::position, sizeof(word));
+		return word;
+	}
+	template<std::size_t ...I>
+	void save(image &img, std::index_sequence<I...>) const {
+		( (void)[&]{
+			auto const word = load<I>();
+			std::memcpy(img.bytes.data() + reg<I>::position, &word, sizeof(word));
+		}(), ...);
+	}
+	template<std::size_t ...I>
+	bool matches(image const &img, std::index_sequence<I...>) const {
+		bool same{true};
+		( (void)(same = (load<I>() == from<I>(img)) && same), ...);
+		return same;
+	}
+	template<std::size_t ...I>
+	void restore(image const &img, std::index_sequence<I...>) {
+		(store<I>(from<I>(img)), ...);
+	}
+	template<std::size_t ...I>
+	std::size_t restore_changed(image const &img, image const &current, std::index_sequence<I...>) {
+		std::size_t written{};
+		( (void)[&]{
+			if (auto const word = from<I>(img); word != from<I>(current)){
+				store<I>(word);
+				++written;
+			}
+		}(), ...);
+		return written;
+	}
+	std::byte volatile *base;
+};
+
+}
+
+#endif /* PSBITFIELD_REGMAP_H_ */
@@ -0,0 +1,208 @@
+#ifndef PSBITFIELD_SIM_H_
+#define PSBITFIELD_SIM_H_
+
+#include "psbitfield.h"
+#include "psbitfield_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// access policies for running register layouts on a host without the hardware.
+// Layouts take the access policy as template argument and name it as member type access,
+// so that snapshot, compose, shadowed and register_block use it for the whole word as well:
+//
+//	template<typename ACCESS=psbf::native_access>
+//	union Ctrl {
+//		using access = ACCESS;
+//		psbf::bitfield<0,32,uint32_t,ACCESS> word;
+//		psbf::bitfield<0,4,uint32_t,ACCESS> mode;
+//		psbf::bitfield<31,1,uint32_t,ACCESS> start;
+//	};
+//	psbf::simulated_device dev{0x100, std::chrono::nanoseconds{200}};
+//	dev.on_write(0x10, [](psbf::simulated_device &d, uint64_t word){ ... });
+//	auto &ctrl = dev.at<Ctrl<psbf::simulated_access<>>>(0x10);
+//	ctrl.start = 1; // takes 400ns: a read and a write, then calls the write hook
+//
+// Use instrumented_access<> to count the accesses of the calling thread, plain_access<> from psbitfield.h
+// to let the compiler optimize accesses of volatile words in ordinary memory.
+// replay() re-issues a trace recorded with PSBF_TRACE_ACCESSES (see psbitfield_trace.h) against a device.
+
+
+namespace psbf {
+
+// counts volatile loads and stores per thread, the accesses use BASE
+template<typename BASE=native_access>
+struct instrumented_access : BASE {
+	static inline thread_local std::size_t loads{};
+	static inline thread_local std::size_t stores{};
+	template<typename UINT>
+	static UINT load(UINT const volatile &word) { ++loads; return BASE::load(word); }
+	template<typename UINT>
+	static void store(UINT volatile &word, UINT newword) { ++stores; BASE::store(word, newword); }
+	static void reset() { loads = stores = 0; }
+};
+
+// register memory of an in-process peripheral. Accesses through simulated_access take the given latency
+// and call the hooks registered for the register's offset, modelling the behaviour of the device.
+// Devices may be accessed from several threads, the hooks run in the accessing thread.
+// Register the hooks before and destroy a device after accessing it from several threads.
+class simulated_device {
+public:
+	using read_hook = std::function<void(simulated_device &)>;
+	using write_hook = std::function<void(simulated_device &, uint64_t)>;
+
+	// the memory of an array of std::byte is aligned for all word types and provides storage for them
+	explicit simulated_device(std::size_t size, std::chrono::nanoseconds latency = std::chrono::nanoseconds{0})
+	:memory(std::make_unique<std::byte[]>(size)),bytes{size},latency{latency}{
+		std::lock_guard<std::mutex> lock{registry().mutex};
+		registry().devices.push_back(this);
+	}
+	~simulated_device(){
+		std::lock_guard<std::mutex> lock{registry().mutex};
+		auto &all = registry().devices;
+		all.erase(std::remove(all.begin(), all.end(), this), all.end());
+	}
+	simulated_device(simulated_device const &) = delete;
+	simulated_device& operator=(simulated_device const &) = delete;
+
+	std::size_t size() const { return bytes; }
+	void volatile * base() { return memory.get(); }
+	template<typename UNION>
+	UNION volatile & at(std::size_t offset) {
+		assert(offset % sizeof(UNION) == 0 && offset + sizeof(UNION) <= bytes);
+		return *reinterpret_cast<UNION volatile *>(address(offset));
+	}
+
+	// called before the register at offset is read, e.g., to update a status register
+	void on_read(std::size_t offset, read_hook hook) { read_hooks[offset] = std::move(hook); }
+	// called after the register at offset is written with the word written, e.g., to start an operation
+	void on_write(std::size_t offset, write_hook hook) { write_hooks[offset] = std::move(hook); }
+
+	// the device's side of a register, without latency and hooks
+	template<typename UINT>
+	UINT peek(std::size_t offset) const {
+		assert(offset % sizeof(UINT) == 0 && offset + sizeof(UINT) <= bytes);
+		UINT word;
+		std::memcpy(&word, memory.get() + offset, sizeof(UINT));
+		return word;
+	}
+	template<typename UINT>
+	void poke(std::size_t offset, UINT word) {
+		assert(offset % sizeof(UINT) == 0 && offset + sizeof(UINT) <= bytes);
+		std::memcpy(address(offset), &word, sizeof(UINT));
+	}
+
+	std::size_t reads() const { return readcount.load(std::memory_order_relaxed); }
+	std::size_t writes() const { return writecount.load(std::memory_order_relaxed); }
+	// total latency of all accesses
+	std::chrono::nanoseconds busy() const { return latency * std::chrono::nanoseconds::rep(reads() + writes()); }
+
+	// the bus side, used by simulated_access
+	template<typename UINT>
+	UINT read(UINT const volatile &word) {
+		std::size_t const offset = offset_of(&word);
+		if (auto hook = read_hooks.find(offset); hook != read_hooks.end()) hook->second(*this);
+		wait();
+		readcount.fetch_add(1, std::memory_order_relaxed);
+		return word;
+	}
+	template<typename UINT>
+	void write(UINT volatile &word, UINT newword) {
+		wait();
+		writecount.fetch_add(1, std::memory_order_relaxed);
+		word = newword;
+		if (auto hook = write_hooks.find(offset_of(&word)); hook != write_hooks.end()) hook->second(*this, newword);
+	}
+	// the device whose register memory contains address, nullptr if none
+	static simulated_device * find(void const volatile *address) {
+		std::lock_guard<std::mutex> lock{registry().mutex};
+		for (auto device : registry().devices) {
+			if (device->contains(address)) return device;
+		}
+		return nullptr;
+	}
+private:
+	struct device_registry {
+		std::mutex mutex{};
+		std::vector<simulated_device *> devices{};
+	};
+	static device_registry & registry() {
+		static device_registry all{};
+		return all;
+	}
+	std::byte * address(std::size_t offset) { return memory.get() + offset; }
+	std::size_t offset_of(void const volatile *address) const {
+		return std::size_t(static_cast<std::byte const volatile *>(address) - memory.get());
+	}
+	bool contains(void const volatile *address) const {
+		auto const begin = reinterpret_cast<std::uintptr_t>(memory.get());
+		auto const where = reinterpret_cast<std::uintptr_t>(address);
+		return where >= begin && where < begin + bytes;
+	}
+	void wait() const {
+		if (latency.count() == 0) return;
+		auto const until = std::chrono::steady_clock::now() + latency;
+		while (std::chrono::steady_clock::now() < until) {}
+	}
+	std::unique_ptr<std::byte[]> memory;
+	std::size_t bytes;
+	std::chrono::nanoseconds latency;
+	std::unordered_map<std::size_t, read_hook> read_hooks{};
+	std::unordered_map<std::size_t, write_hook> write_hooks{};
+	std::atomic<std::size_t> readcount{};
+	std::atomic<std::size_t> writecount{};
+};
+
+// words within a simulated_device are accessed through the device, others through BASE
+template<typename BASE=native_access>
+struct simulated_access : BASE {
+	template<typename UINT>
+	static UINT load(UINT const volatile &word) {
+		if (auto device = simulated_device::find(&word)) return device->read(word);
+		return BASE::load(word);
+	}
+	template<typename UINT>
+	static void store(UINT volatile &word, UINT newword) {
+		if (auto device = simulated_device::find(&word)) device->write(word, newword);
+		else BASE::store(word, newword);
+	}
+};
+
+// re-issue the accesses of records to dev, the register at address base is at offset 0 of dev.
+// Accesses outside of dev are skipped, the number of accesses replayed is returned.
+// Use dev.busy() to compare the bus time of access patterns.
+inline std::size_t replay(std::vector<trace_record> const &records, simulated_device &dev, std::uintptr_t base) {
+	std::size_t replayed{};
+	for (auto const &record : records) {
+		if (record.address() < base) continue;
+		std::size_t const offset = record.address() - base;
+		if (record.size() == 0 || offset % record.size() != 0 || offset + record.size() > dev.size()) continue;
+		auto const access = [&](auto word) {
+			using UINT = decltype(word);
+			auto &target = *reinterpret_cast<UINT volatile *>(static_cast<std::byte volatile *>(dev.base()) + offset);
+			if (record.write()) dev.write(target, UINT(record.word));
+			else dev.read(target);
+		};
+		switch (record.size()) {
+		case 1: access(uint8_t{}); break;
+		case 2: access(uint16_t{}); break;
+		case 4: access(uint32_t{}); break;
+		case 8: access(uint64_t{}); break;
+		default: continue;
+		}
+		++replayed;
+	}
+	return replayed;
+}
+
+}
+
+#endif /* PSBITFIELD_SIM_H_ */
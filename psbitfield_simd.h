@@ -0,0 +1,332 @@
+#ifndef PSBITFIELD_SIMD_H_
+#define PSBITFIELD_SIMD_H_
+
+#include "psbitfield.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+
+// bulk operations on one field across arrays of plain (non-volatile) words in host byte order.
+// On x86 the kernels use AVX2 or AVX-512, selected at runtime, with a scalar loop for the remainder.
+// Requires C++20 for std::span.
+//
+// Usage:
+//
+//	union Status { psbf::allbits32 word; psbf::bits32<4,12> level; };
+//	std::vector<uint32_t> captured = ...;
+//	std::vector<uint32_t> levels(captured.size());
+//	psbf::extract_all<decltype(Status::level)>(captured, levels);
+//	psbf::insert_all<decltype(Status::level)>(captured, levels);
+//
+//	union Sensor { psbf::allbits16 word; psbf::fixedpoint<psbf::sbits16<0,16>,12> temperature; };
+//	std::vector<float> temperatures(samples.size());
+//	psbf::convert_all<decltype(Sensor::temperature)>(samples, temperatures);
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define PSBF_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace psbf {
+
+enum class simd_isa { scalar, avx2, avx512 };
+
+inline simd_isa best_simd_isa() {
+#ifdef PSBF_SIMD_X86
+	static simd_isa const best =
+			__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") ? simd_isa::avx512
+			: __builtin_cpu_supports("avx2") ? simd_isa::avx2
+			: simd_isa::scalar;
+	return best;
+#else
+	return simd_isa::scalar;
+#endif
+}
+
+namespace detail::simd {
+// the field is stored in host byte order: mask and lsb apply to the words as they are, e.g., not psbf::bits32_be
+template<typename FIELD>
+constexpr bool host_byteorder() {
+	using word = typename FIELD::result_type;
+	constexpr word probe = word(0x0807'0605'0403'0201u);
+	return FIELD::access::encode(probe) == probe;
+}
+
+#ifdef PSBF_SIMD_X86
+// 8-bit words use 16-bit shifts, masking with widthmask keeps bits from crossing into the neighbouring byte
+
+template<typename UINT>
+__attribute__((target("avx2")))
+inline __m256i broadcast256(UINT x) {
+	if constexpr (sizeof(UINT) == 8) return _mm256_set1_epi64x(static_cast<long long>(x));
+	else if constexpr (sizeof(UINT) == 4) return _mm256_set1_epi32(static_cast<int>(x));
+	else if constexpr (sizeof(UINT) == 2) return _mm256_set1_epi16(static_cast<short>(x));
+	else return _mm256_set1_epi8(static_cast<char>(x));
+}
+template<typename UINT, int count>
+__attribute__((target("avx2")))
+inline __m256i shiftright256(__m256i v) {
+	if constexpr (count == 0) return v;
+	else if constexpr (sizeof(UINT) == 8) return _mm256_srli_epi64(v, count);
+	else if constexpr (sizeof(UINT) == 4) return _mm256_srli_epi32(v, count);
+	else return _mm256_srli_epi16(v, count);
+}
+
+template<typename UINT, int count>
+__attribute__((target("avx2")))
+inline __m256i shiftleft256(__m256i v) {
+	if constexpr (count == 0) return v;
+	else if constexpr (sizeof(UINT) == 8) return _mm256_slli_epi64(v, count);
+	else if constexpr (sizeof(UINT) == 4) return _mm256_slli_epi32(v, count);
+	else return _mm256_slli_epi16(v, count);
+}
+
+// fixed-point fields of words up to 32 bits convert to float in 32-bit lanes
+template<typename FIXED>
+constexpr bool converts_to_float() {
+	return std::is_same_v<float, typename FIXED::value_type> && sizeof(typename FIXED::result_type) <= 4
+			&& (std::is_signed_v<typename FIXED::raw_type> || FIXED::bitwidth < 32);
+}
+template<typename UINT>
+__attribute__((target("avx2")))
+inline __m256i widen256(UINT const *words) {
+	if constexpr (sizeof(UINT) == 4) return _mm256_loadu_si256(reinterpret_cast<__m256i const *>(words));
+	else if constexpr (sizeof(UINT) == 2) return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const *>(words)));
+	else return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const *>(words)));
+}
+// the raw value of the field in each 32-bit lane, sign-extended for signed fields
+template<typename FIXED>
+__attribute__((target("avx2")))
+inline __m256i raw256(__m256i v) {
+	if constexpr (std::is_signed_v<typename FIXED::raw_type>) {
+		return _mm256_srai_epi32(_mm256_slli_epi32(v, 32 - FIXED::lsb - FIXED::bitwidth), 32 - FIXED::bitwidth);
+	} else {
+		return _mm256_and_si256(_mm256_srli_epi32(v, FIXED::lsb), _mm256_set1_epi32(static_cast<int>(FIXED::widthmask)));
+	}
+}
+
+#if defined(__GNUC__) && ! defined(__clang__)
+#pragma GCC diagnostic push
+// false positive in GCC's AVX-512 headers when inlined at -O2
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+template<typename UINT>
+__attribute__((target("avx512f,avx512bw")))
+inline __m512i broadcast512(UINT x) {
+	if constexpr (sizeof(UINT) == 8) return _mm512_set1_epi64(static_cast<long long>(x));
+	else if constexpr (sizeof(UINT) == 4) return _mm512_set1_epi32(static_cast<int>(x));
+	else if constexpr (sizeof(UINT) == 2) return _mm512_set1_epi16(static_cast<short>(x));
+	else return _mm512_set1_epi8(static_cast<char>(x));
+}
+template<typename UINT, int count>
+__attribute__((target("avx512f,avx512bw")))
+inline __m512i shiftright512(__m512i v) {
+	if constexpr (count == 0) return v;
+	else if constexpr (sizeof(UINT) == 8) return _mm512_srli_epi64(v, count);
+	else if constexpr (sizeof(UINT) == 4) return _mm512_srli_epi32(v, count);
+	else return _mm512_srli_epi16(v, count);
+}
+template<typename UINT, int count>
+__attribute__((target("avx512f,avx512bw")))
+inline __m512i shiftleft512(__m512i v) {
+	if constexpr (count == 0) return v;
+	else if constexpr (sizeof(UINT) == 8) return _mm512_slli_epi64(v, count);
+	else if constexpr (sizeof(UINT) == 4) return _mm512_slli_epi32(v, count);
+	else return _mm512_slli_epi16(v, count);
+}
+template<typename UINT>
+__attribute__((target("avx512f,avx512bw")))
+inline __m512i widen512(UINT const *words) {
+	if constexpr (sizeof(UINT) == 4) return _mm512_loadu_si512(words);
+	else if constexpr (sizeof(UINT) == 2) return _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(words)));
+	else return _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const *>(words)));
+}
+template<typename FIXED>
+__attribute__((target("avx512f,avx512bw")))
+inline __m512i raw512(__m512i v) {
+	if constexpr (std::is_signed_v<typename FIXED::raw_type>) {
+		return _mm512_srai_epi32(_mm512_slli_epi32(v, 32 - FIXED::lsb - FIXED::bitwidth), 32 - FIXED::bitwidth);
+	} else {
+		return _mm512_and_si512(_mm512_srli_epi32(v, FIXED::lsb), _mm512_set1_epi32(static_cast<int>(FIXED::widthmask)));
+	}
+}
+
+// the kernels return the number of words processed, the caller handles the rest
+template<typename FIELD>
+__attribute__((target("avx2")))
+std::size_t extract_avx2(typename FIELD::result_type const *words, typename FIELD::result_type *values, std::size_t n) {
+	using UINT = typename FIELD::result_type;
+	constexpr std::size_t lanes = sizeof(__m256i) / sizeof(UINT);
+	__m256i const widthmask = broadcast256(UINT(FIELD::widthmask));
+	std::size_t i = 0;
+	for (; i + lanes <= n; i += lanes) {
+		__m256i const v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(words + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(values + i),
+				_mm256_and_si256(shiftright256<UINT, FIELD::lsb>(v), widthmask));
+	}
+	return i;
+}
+template<typename FIELD>
+__attribute__((target("avx512f,avx512bw")))
+std::size_t extract_avx512(typename FIELD::result_type const *words, typename FIELD::result_type *values, std::size_t n) {
+	using UINT = typename FIELD::result_type;
+	constexpr std::size_t lanes = sizeof(__m512i) / sizeof(UINT);
+	__m512i const widthmask = broadcast512(UINT(FIELD::widthmask));
+	std::size_t i = 0;
+	for (; i + lanes <= n; i += lanes) {
+		__m512i const v = _mm512_loadu_si512(words + i);
+		_mm512_storeu_si512(values + i, _mm512_and_si512(shiftright512<UINT, FIELD::lsb>(v), widthmask));
+	}
+	return i;
+}
+// overflow is set, if any value does not fit into the field
+template<typename FIELD>
+__attribute__((target("avx2")))
+std::size_t insert_avx2(typename FIELD::result_type *words, typename FIELD::result_type const *values, std::size_t n, bool &overflow) {
+	using UINT = typename FIELD::result_type;
+	constexpr std::size_t lanes = sizeof(__m256i) / sizeof(UINT);
+	__m256i const widthmask = broadcast256(UINT(FIELD::widthmask));
+	__m256i const mask = broadcast256(UINT(FIELD::mask));
+	__m256i excess = _mm256_setzero_si256();
+	std::size_t i = 0;
+	for (; i + lanes <= n; i += lanes) {
+		__m256i const v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(values + i));
+		__m256i const w = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(words + i));
+		excess = _mm256_or_si256(excess, _mm256_andnot_si256(widthmask, v));
+		__m256i const placed = shiftleft256<UINT, FIELD::lsb>(_mm256_and_si256(v, widthmask));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(words + i), _mm256_or_si256(_mm256_andnot_si256(mask, w), placed));
+	}
+	overflow = overflow || ! _mm256_testz_si256(excess, excess);
+	return i;
+}
+template<typename FIELD>
+__attribute__((target("avx512f,avx512bw")))
+std::size_t insert_avx512(typename FIELD::result_type *words, typename FIELD::result_type const *values, std::size_t n, bool &overflow) {
+	using UINT = typename FIELD::result_type;
+	constexpr std::size_t lanes = sizeof(__m512i) / sizeof(UINT);
+	__m512i const widthmask = broadcast512(UINT(FIELD::widthmask));
+	__m512i const mask = broadcast512(UINT(FIELD::mask));
+	__m512i excess = _mm512_setzero_si512();
+	std::size_t i = 0;
+	for (; i + lanes <= n; i += lanes) {
+		__m512i const v = _mm512_loadu_si512(values + i);
+		__m512i const w = _mm512_loadu_si512(words + i);
+		excess = _mm512_or_si512(excess, _mm512_andnot_si512(widthmask, v));
+		__m512i const placed = shiftleft512<UINT, FIELD::lsb>(_mm512_and_si512(v, widthmask));
+		_mm512_storeu_si512(words + i, _mm512_or_si512(_mm512_andnot_si512(mask, w), placed));
+	}
+	overflow = overflow || _mm512_test_epi64_mask(excess, excess) != 0;
+	return i;
+}
+template<typename FIXED>
+__attribute__((target("avx2")))
+std::size_t convert_avx2(typename FIXED::result_type const *words, float *reals, std::size_t n) {
+	constexpr std::size_t lanes = sizeof(__m256) / sizeof(float);
+	__m256 const resolution = _mm256_set1_ps(FIXED::resolution);
+	std::size_t i = 0;
+	for (; i + lanes <= n; i += lanes) {
+		__m256i const raw = raw256<FIXED>(widen256(words + i));
+		_mm256_storeu_ps(reals + i, _mm256_mul_ps(_mm256_cvtepi32_ps(raw), resolution));
+	}
+	return i;
+}
+template<typename FIXED>
+__attribute__((target("avx512f,avx512bw")))
+std::size_t convert_avx512(typename FIXED::result_type const *words, float *reals, std::size_t n) {
+	constexpr std::size_t lanes = sizeof(__m512) / sizeof(float);
+	__m512 const resolution = _mm512_set1_ps(FIXED::resolution);
+	std::size_t i = 0;
+	for (; i + lanes <= n; i += lanes) {
+		__m512i const raw = raw512<FIXED>(widen512(words + i));
+		_mm512_storeu_ps(reals + i, _mm512_mul_ps(_mm512_cvtepi32_ps(raw), resolution));
+	}
+	return i;
+}
+#if defined(__GNUC__) && ! defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+}
+
+// values[i] = FIELD::extract(words[i]) for all words
+template<typename FIELD>
+void extract_all(std::span<typename FIELD::result_type const> words, std::span<typename FIELD::result_type> values,
+		simd_isa isa = best_simd_isa()) {
+	static_assert(detail::simd::host_byteorder<FIELD>(), "bulk operations need fields in host byte order");
+	assert(values.size() >= words.size());
+	std::size_t i = 0;
+#ifdef PSBF_SIMD_X86
+	isa = std::min(isa, best_simd_isa());
+	if (isa == simd_isa::avx512) {
+		i = detail::simd::extract_avx512<FIELD>(words.data(), values.data(), words.size());
+	}
+	if (isa >= simd_isa::avx2) {
+		i += detail::simd::extract_avx2<FIELD>(words.data() + i, values.data() + i, words.size() - i);
+	}
+#else
+	(void) isa;
+#endif
+	for (; i < words.size(); ++i) {
+		values[i] = FIELD::extract(words[i]);
+	}
+}
+
+// reals[i] = FIXED::value_of(words[i]) for all words, e.g., the values of a psbf::fixedpoint field.
+// Fields converting to float in words of up to 32 bits use the SIMD kernels, with the same results as the scalar conversion.
+template<typename FIXED>
+void convert_all(std::span<typename FIXED::result_type const> words, std::span<typename FIXED::value_type> reals,
+		simd_isa isa = best_simd_isa()) {
+	static_assert(detail::simd::host_byteorder<FIXED>(), "bulk operations need fields in host byte order");
+	assert(reals.size() >= words.size());
+	std::size_t i = 0;
+#ifdef PSBF_SIMD_X86
+	if constexpr (detail::simd::converts_to_float<FIXED>()) {
+		isa = std::min(isa, best_simd_isa());
+		if (isa == simd_isa::avx512) {
+			i = detail::simd::convert_avx512<FIXED>(words.data(), reals.data(), words.size());
+		}
+		if (isa >= simd_isa::avx2) {
+			i += detail::simd::convert_avx2<FIXED>(words.data() + i, reals.data() + i, words.size() - i);
+		}
+	}
+#endif
+	(void) isa;
+	for (; i < words.size(); ++i) {
+		reals[i] = FIXED::value_of(words[i]);
+	}
+}
+
+// set the field in all words: words[i] = (words[i] & ~FIELD::mask) | FIELD::place(values[i]),
+// asserts that all values fit into the field, like bitfield::operator=
+template<typename FIELD>
+void insert_all(std::span<typename FIELD::result_type> words, std::span<typename FIELD::result_type const> values,
+		simd_isa isa = best_simd_isa()) {
+	static_assert(detail::simd::host_byteorder<FIELD>(), "bulk operations need fields in host byte order");
+	using expr_type = typename FIELD::expr_type;
+	assert(values.size() >= words.size());
+	std::size_t i = 0;
+	bool overflow = false;
+#ifdef PSBF_SIMD_X86
+	isa = std::min(isa, best_simd_isa());
+	if (isa == simd_isa::avx512) {
+		i = detail::simd::insert_avx512<FIELD>(words.data(), values.data(), words.size(), overflow);
+	}
+	if (isa >= simd_isa::avx2) {
+		i += detail::simd::insert_avx2<FIELD>(words.data() + i, values.data() + i, words.size() - i, overflow);
+	}
+#else
+	(void) isa;
+#endif
+	expr_type excess = 0;
+	for (; i < words.size(); ++i) {
+		excess |= values[i] & ~FIELD::widthmask;
+		words[i] = typename FIELD::result_type((expr_type(words[i]) & ~FIELD::mask) | ((expr_type(values[i]) & FIELD::widthmask) << FIELD::lsb));
+	}
+	assert(! overflow && excess == 0);
+	(void) overflow; (void) excess;
+}
+
+}
+
+#endif /* PSBITFIELD_SIMD_H_ */
@@ -0,0 +1,128 @@
+#ifndef PSBITFIELD_STREAM_H_
+#define PSBITFIELD_STREAM_H_
+
+#include "psbitfield.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// serialize values of bitfield widths without padding into 64-bit words, the first value in the least significant bits.
+// Both streams keep a 64-bit accumulator and access the buffer only in whole words.
+//
+// Usage:
+//
+//	union Record {
+//		psbf::allbits16 word;
+//		psbf::bits16<0,3> kind;
+//		psbf::bits16<3,9> level;
+//	};
+//	psbf::bit_ostream out;
+//	out.put_fields<&Record::kind, &Record::level>(record); // 12 bits
+//	out.put<5>(extra);
+//	std::vector<uint64_t> const words = out.take();
+//
+//	psbf::bit_istream in{words.data(), words.size()};
+//	Record copy{};
+//	in.get_fields<&Record::kind, &Record::level>(copy);
+//	auto const extra = in.get<5>();
+
+
+namespace psbf {
+
+namespace detail {
+constexpr uint64_t lowbits(unsigned width) {
+	return width >= 64 ? ~uint64_t{} : (uint64_t{1} << width) - 1u;
+}
+}
+
+class bit_ostream {
+public:
+	void write(uint64_t value, unsigned width) {
+		assert(width > 0 && width <= 64);
+		assert(0 == (value & ~detail::lowbits(width)));
+		accumulator |= value << used;
+		used += width;
+		if (used >= 64) {
+			words.push_back(accumulator);
+			used -= 64;
+			accumulator = used == 0 ? 0 : value >> (width - used);
+		}
+	}
+	template<uint8_t width>
+	void put(uint64_t value) {
+		static_assert(width > 0 && width <= 64);
+		write(value, width);
+	}
+	template<typename BF>
+	void put(fieldvalue<BF> fv) {
+		write(BF::bits_of(fv.value), BF::bitwidth);
+	}
+	// write the given fields of record, each with its width
+	template<auto ...members, typename UNION>
+	void put_fields(UNION const &record) {
+		(put(fieldvalue<detail::field_t<members>>{record.*members}), ...);
+	}
+	// number of bits written
+	std::size_t size() const { return words.size() * 64 + used; }
+	// the words written so far, including the incomplete last word, the stream starts over empty
+	std::vector<uint64_t> take() {
+		if (used > 0) words.push_back(accumulator);
+		std::vector<uint64_t> result{std::move(words)};
+		words.clear();
+		accumulator = 0;
+		used = 0;
+		return result;
+	}
+private:
+	std::vector<uint64_t> words{};
+	uint64_t accumulator{};
+	unsigned used{};
+};
+
+class bit_istream {
+public:
+	bit_istream(uint64_t const *words, std::size_t count):next{words},end{words + count}{}
+
+	uint64_t read(unsigned width) {
+		assert(width > 0 && width <= 64);
+		if (width <= available) {
+			uint64_t const value = accumulator & detail::lowbits(width);
+			accumulator = width == 64 ? 0 : accumulator >> width;
+			available -= width;
+			return value;
+		}
+		assert(next != end && "read beyond end of bit stream");
+		uint64_t const word = *next++;
+		unsigned const rest = width - available; // bits from the new word
+		uint64_t const value = (accumulator | word << available) & detail::lowbits(width);
+		accumulator = rest == 64 ? 0 : word >> rest;
+		available = 64 - rest;
+		return value;
+	}
+	template<uint8_t width>
+	uint64_t get() {
+		static_assert(width > 0 && width <= 64);
+		return read(width);
+	}
+	template<typename BF>
+	typename BF::value_type get() {
+		return BF::value_of(typename BF::result_type(BF::place(typename BF::result_type(read(BF::bitwidth)))));
+	}
+	// read the given fields of record, each with its width
+	template<auto ...members, typename UNION>
+	void get_fields(UNION &record) {
+		(((record.*members) = get<detail::field_t<members>>()), ...);
+	}
+	// number of bits left, including padding of the last word
+	std::size_t remaining() const { return std::size_t(end - next) * 64 + available; }
+private:
+	uint64_t const *next;
+	uint64_t const *end;
+	uint64_t accumulator{};
+	unsigned available{};
+};
+
+}
+
+#endif /* PSBITFIELD_STREAM_H_ */
@@ -0,0 +1,227 @@
+#ifndef PSBITFIELD_TRACE_H_
+#define PSBITFIELD_TRACE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <x86intrin.h>
+#endif
+
+// recording volatile accesses for performance debugging of drivers.
+// Define PSBF_TRACE_ACCESSES for the whole program (all translation units!) to record each volatile
+// read and write of bitfields, modify, snapshot and the other whole-word helpers of psbitfield.h:
+// address, size and mask of the word, the word read or written and a time stamp (TSC on x86).
+// Each thread records into its own ring buffer of PSBF_TRACE_CAPACITY records without locking,
+// when it is full the oldest records are overwritten. Buffers of ended threads are reused by new threads.
+// Records can be read while other threads record.
+//
+//	psbf::save_trace(file, psbf::trace_records()); // all threads, ordered by time stamp
+//
+// A trace can be replayed against a psbf::simulated_device, see psbitfield_sim.h and src/PSBitFieldReplay.cpp.
+//
+// The file format is the magic "PSBFTRC1" followed by the records, each four little-endian 64-bit words:
+// time stamp, address with the size in bytes in bits 56..62 and bit 63 set for writes, mask, word.
+
+
+#ifndef PSBF_TRACE_CAPACITY
+#define PSBF_TRACE_CAPACITY 65536
+#endif
+
+namespace psbf {
+
+struct trace_record {
+	uint64_t timestamp;
+	uint64_t location; // address, size and direction
+	uint64_t mask;     // the bits of the accessed field(s), all bits for whole-word accesses
+	uint64_t word;     // as read or written, in stored representation
+
+	static constexpr inline uint64_t writebit = uint64_t{1} << 63;
+	static constexpr inline unsigned sizeshift = 56;
+	static constexpr inline uint64_t addressmask = (uint64_t{1} << sizeshift) - 1u;
+
+	std::uintptr_t address() const { return std::uintptr_t(location & addressmask); }
+	unsigned size() const { return unsigned((location & ~writebit) >> sizeshift); }
+	bool write() const { return (location & writebit) != 0; }
+};
+
+namespace detail {
+inline uint64_t timestamp() {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+	return __rdtsc();
+#else
+	return uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// written by one thread at a time, read by any thread while it records: a sequence lock per buffer.
+// The words of the records are relaxed atomics, head counts the records pushed. Before overwriting a slot,
+// the writer has published the head of its previous record. A reader copies the slots, then reads head again
+// and drops the records that may have been overwritten meanwhile: at most capacity - 1 records are kept.
+class trace_buffer {
+public:
+	static constexpr inline std::size_t capacity = PSBF_TRACE_CAPACITY;
+	static_assert(capacity > 1 && (capacity & (capacity - 1)) == 0, "trace capacity must be a power of two");
+	void push(trace_record const &record) {
+		uint64_t const next = head.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release); // head of the previous record before the slot
+		auto &slot = slots[next & (capacity - 1)];
+		slot[0].store(record.timestamp, std::memory_order_relaxed);
+		slot[1].store(record.location, std::memory_order_relaxed);
+		slot[2].store(record.mask, std::memory_order_relaxed);
+		slot[3].store(record.word, std::memory_order_relaxed);
+		head.store(next + 1, std::memory_order_release);
+	}
+	// oldest first
+	std::vector<trace_record> recorded() const {
+		uint64_t const end = head.load(std::memory_order_acquire);
+		std::vector<trace_record> result{};
+		result.reserve(std::size_t(end - oldest(end)));
+		for (uint64_t i = oldest(end); i < end; ++i) {
+			auto const &slot = slots[i & (capacity - 1)];
+			result.push_back(trace_record{slot[0].load(std::memory_order_relaxed), slot[1].load(std::memory_order_relaxed),
+				slot[2].load(std::memory_order_relaxed), slot[3].load(std::memory_order_relaxed)});
+		}
+		std::atomic_thread_fence(std::memory_order_acquire); // the slots before head
+		uint64_t const overwritten = oldest(head.load(std::memory_order_relaxed)) - oldest(end);
+		result.erase(result.begin(), result.begin() + std::ptrdiff_t(std::min<uint64_t>(overwritten, result.size())));
+		return result;
+	}
+	// while no thread records into the buffer
+	void clear() { head.store(0, std::memory_order_release); }
+private:
+	// the first record that is not being overwritten when end records were pushed
+	static uint64_t oldest(uint64_t end) { return end >= capacity ? end - capacity + 1 : 0; }
+	using slot = std::atomic<uint64_t>[4];
+	std::unique_ptr<slot[]> slots{std::make_unique<slot[]>(capacity)};
+	std::atomic<uint64_t> head{};
+};
+
+// the buffers of all threads. The buffer of an ended thread is kept with its records
+// and reused by the next thread starting to record, so there are no more buffers than threads recording at once.
+class trace_buffers {
+public:
+	static trace_buffers & instance() {
+		static trace_buffers buffers{};
+		return buffers;
+	}
+	trace_buffer & acquire() {
+		std::lock_guard<std::mutex> lock{mutex};
+		if (! idle.empty()) {
+			trace_buffer &buffer = *idle.back();
+			idle.pop_back();
+			return buffer;
+		}
+		buffers.push_back(std::make_unique<trace_buffer>());
+		return *buffers.back();
+	}
+	void release(trace_buffer &buffer) {
+		std::lock_guard<std::mutex> lock{mutex};
+		idle.push_back(&buffer);
+	}
+	std::vector<trace_buffer *> all() {
+		std::lock_guard<std::mutex> lock{mutex};
+		std::vector<trace_buffer *> result{};
+		for (auto const &buffer : buffers) result.push_back(buffer.get());
+		return result;
+	}
+	std::size_t size() {
+		std::lock_guard<std::mutex> lock{mutex};
+		return buffers.size();
+	}
+private:
+	std::mutex mutex{};
+	std::vector<std::unique_ptr<trace_buffer>> buffers{};
+	std::vector<trace_buffer *> idle{};
+};
+
+struct thread_trace_buffer {
+	// constructing the buffers first ensures they are destroyed after the buffer of each thread is released
+	thread_trace_buffer():buffer{trace_buffers::instance().acquire()}{}
+	~thread_trace_buffer() { trace_buffers::instance().release(buffer); }
+	thread_trace_buffer(thread_trace_buffer const &) = delete;
+	thread_trace_buffer& operator=(thread_trace_buffer const &) = delete;
+	trace_buffer &buffer;
+};
+inline trace_buffer & thread_trace() {
+	thread_local thread_trace_buffer trace{};
+	return trace.buffer;
+}
+
+inline void trace_access(void const volatile *word, unsigned size, uint64_t mask, uint64_t value, bool write) {
+	uint64_t const location = (reinterpret_cast<std::uintptr_t>(word) & trace_record::addressmask)
+			| uint64_t{size} << trace_record::sizeshift | (write ? trace_record::writebit : 0);
+	thread_trace().push(trace_record{timestamp(), location, mask, value});
+}
+
+inline void put64(std::FILE *out, uint64_t value) {
+	unsigned char bytes[8];
+	for (auto &byte : bytes) {
+		byte = static_cast<unsigned char>(value);
+		value >>= 8;
+	}
+	std::fwrite(bytes, 1, sizeof(bytes), out);
+}
+inline bool get64(std::FILE *in, uint64_t &value) {
+	unsigned char bytes[8];
+	if (std::fread(bytes, 1, sizeof(bytes), in) != sizeof(bytes)) return false;
+	value = 0;
+	for (std::size_t i = sizeof(bytes); i-- > 0;) {
+		value = value << 8 | bytes[i];
+	}
+	return true;
+}
+inline constexpr char trace_magic[8]{'P','S','B','F','T','R','C','1'};
+}
+
+// the records of all threads, including ended threads whose buffers were not reused yet, ordered by time stamp
+inline std::vector<trace_record> trace_records() {
+	std::vector<trace_record> all{};
+	for (auto buffer : detail::trace_buffers::instance().all()) {
+		auto const recorded = buffer->recorded();
+		all.insert(all.end(), recorded.begin(), recorded.end());
+	}
+	std::stable_sort(all.begin(), all.end(), [](trace_record const &l, trace_record const &r){
+		return l.timestamp < r.timestamp;
+	});
+	return all;
+}
+// discard the records of all threads, while no other thread records
+inline void reset_trace() {
+	for (auto buffer : detail::trace_buffers::instance().all()) {
+		buffer->clear();
+	}
+}
+
+inline void save_trace(std::FILE *out, std::vector<trace_record> const &records) {
+	std::fwrite(detail::trace_magic, 1, sizeof(detail::trace_magic), out);
+	for (auto const &record : records) {
+		detail::put64(out, record.timestamp);
+		detail::put64(out, record.location);
+		detail::put64(out, record.mask);
+		detail::put64(out, record.word);
+	}
+}
+// the records of a saved trace, empty if the file is not a trace
+inline std::vector<trace_record> load_trace(std::FILE *in) {
+	char magic[sizeof(detail::trace_magic)]{};
+	if (std::fread(magic, 1, sizeof(magic), in) != sizeof(magic)
+			|| ! std::equal(magic, magic + sizeof(magic), detail::trace_magic)) return {};
+	std::vector<trace_record> records{};
+	trace_record record{};
+	while (detail::get64(in, record.timestamp) && detail::get64(in, record.location)
+			&& detail::get64(in, record.mask) && detail::get64(in, record.word)) {
+		records.push_back(record);
+	}
+	return records;
+}
+
+}
+
+#endif /* PSBITFIELD_TRACE_H_ */
@@ -0,0 +1,116 @@
+#ifndef PSBITFIELD_WIDE_H_
+#define PSBITFIELD_WIDE_H_
+
+#include "psbitfield.h"
+
+#include <algorithm>
+#include <cstddef>
+
+// bitfields within a block of several words, e.g., a 256-bit DMA descriptor, to be used within unions.
+// Fields may straddle word boundaries, reading or writing a field only accesses the words it overlaps,
+// words completely covered by the field are written without reading them first.
+// Fields up to 64 bits are uint64_t, wider fields up to 128 bits need unsigned __int128.
+//
+// Usage:
+//
+//	union Descriptor {
+//		psbf::widewords<256> words; // should be the first to ensure init: Descriptor desc{};
+//		psbf::widebits<256,0,48> address;
+//		psbf::widebits<256,60,8> flags;   // in words 0 and 1
+//		psbf::widebits<256,128,128> tag;  // words 2 and 3, unsigned __int128
+//	};
+//	Descriptor volatile desc{};
+//	desc.flags = 0xA5;
+
+
+namespace psbf {
+
+namespace detail {
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 uint128;
+#endif
+template<uint16_t width>
+using wide_value_t =
+#ifdef __SIZEOF_INT128__
+		std::conditional_t<(width > 64), uint128, uint64_t>;
+#else
+		uint64_t;
+#endif
+}
+
+// all words of the block, for use as first union member
+template<std::size_t bits, typename UINT=uint64_t>
+struct widewords {
+	static_assert(std::numeric_limits<UINT>::is_integer && ! std::numeric_limits<UINT>::is_signed, "must use unsigned word type");
+	static constexpr inline std::size_t wordsize = std::numeric_limits<UINT>::digits;
+	static constexpr inline std::size_t words = bits / wordsize;
+	static_assert(bits % wordsize == 0 && words > 0, "block must consist of whole words");
+
+	constexpr UINT & operator[](std::size_t i) & { return allbits[i]; }
+	constexpr UINT const & operator[](std::size_t i) const & { return allbits[i]; }
+	UINT volatile & operator[](std::size_t i) volatile & { return allbits[i]; }
+	UINT const volatile & operator[](std::size_t i) const volatile & { return allbits[i]; }
+	// prevent copying as struct and thus surrounding union:
+	widewords& operator=(widewords&&) & noexcept = delete;
+	UINT allbits[words];
+};
+
+template<std::size_t bits, uint16_t from, uint16_t width, typename UINT=uint64_t>
+struct widebits {
+	using word_type = UINT;
+	using result_type = detail::wide_value_t<width>;
+	static constexpr inline std::size_t wordsize = widewords<bits,UINT>::wordsize;
+	static constexpr inline std::size_t words = widewords<bits,UINT>::words;
+	static_assert(width > 0, "zero-size bitfields not supported");
+	static_assert(width <= std::numeric_limits<result_type>::digits, "bitfield too wide for result type");
+	static_assert(from + width <= bits, "bitfield too wide");
+	static constexpr inline std::size_t first = from / wordsize;
+	static constexpr inline std::size_t last = (from + width - 1) / wordsize;
+	static constexpr inline result_type widthmask = (width == std::numeric_limits<result_type>::digits)?result_type(-1):(result_type(1)<<width)-1;
+
+	// the bits of the field within word i
+	static constexpr UINT wordmask(std::size_t i) {
+		std::size_t const lo = std::max<std::size_t>(from, i * wordsize) - i * wordsize;
+		std::size_t const hi = std::min<std::size_t>(from + width, (i + 1) * wordsize) - i * wordsize;
+		return UINT((hi - lo == wordsize ? UINT(-1) : UINT((UINT(1) << (hi - lo)) - 1u)) << lo);
+	}
+
+	operator result_type() const volatile { return read(allbits); }
+	constexpr
+	operator result_type() const { return read(allbits); }
+
+	void operator=(result_type newval) volatile & { // don't support chaining!
+		write(allbits, newval);
+	}
+	constexpr void operator=(result_type newval) & { // don't support chaining!
+		write(allbits, newval);
+	}
+	// prevent copying as struct and thus surrounding union:
+	widebits& operator=(widebits&&) & noexcept = delete;
+	UINT allbits[words];
+private:
+	template<typename WORDS>
+	static constexpr result_type read(WORDS const &block) {
+		result_type value{};
+		for (std::size_t i = first; i <= last; ++i) {
+			result_type const part = result_type(block[i] & wordmask(i));
+			if (i * wordsize >= from) value |= part << (i * wordsize - from);
+			else value |= part >> (from - i * wordsize);
+		}
+		return value;
+	}
+	template<typename WORDS>
+	static constexpr void write(WORDS &block, result_type newval) {
+		assert(0==(newval & ~widthmask));
+		for (std::size_t i = first; i <= last; ++i) {
+			result_type const part = (i * wordsize >= from) ? newval >> (i * wordsize - from) : newval << (from - i * wordsize);
+			UINT const newbits = UINT(UINT(part) & wordmask(i));
+			if (wordmask(i) == UINT(-1)) block[i] = newbits; // no need to read
+			else block[i] = UINT((block[i] & UINT(~wordmask(i))) | newbits);
+		}
+	}
+};
+
+}
+
+#endif /* PSBITFIELD_WIDE_H_ */
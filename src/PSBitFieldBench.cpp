@@ -0,0 +1,188 @@
+#include "psbitfield.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// microbenchmarks of psbf::bitfield against native bitfields and hand-written masking.
+// Each operation accesses one word of an array, results are ns/op and, where perf events
+// are available (Linux, perf_event_paranoid permitting), retired user-space instructions/op.
+// Run with: make bench
+
+namespace {
+
+class instruction_counter {
+public:
+	instruction_counter(){
+#if defined(__linux__)
+		perf_event_attr attr{};
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+	}
+	~instruction_counter(){
+#if defined(__linux__)
+		if (fd >= 0) close(fd);
+#endif
+	}
+	instruction_counter(instruction_counter const &) = delete;
+	instruction_counter& operator=(instruction_counter const &) = delete;
+	bool available() const { return fd >= 0; }
+	void start(){
+#if defined(__linux__)
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+	// instructions since start()
+	uint64_t stop(){
+		uint64_t count{};
+#if defined(__linux__)
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(fd, &count, sizeof(count)) != sizeof(count)) count = 0;
+		}
+#endif
+		return count;
+	}
+private:
+	int fd{-1};
+};
+
+constexpr std::size_t words = 4096;
+constexpr unsigned repetitions = 2000;
+uint64_t volatile sink;
+
+// op() performs one operation on each of the words and returns a checksum
+template<typename OP>
+void run(char const *word, char const *name, OP op){
+	static instruction_counter counter{};
+	uint64_t sum = op(); // warm up
+	auto const start = std::chrono::steady_clock::now();
+	counter.start();
+	for (unsigned r = 0; r < repetitions; ++r) {
+		sum += op();
+	}
+	uint64_t const instructions = counter.stop();
+	auto const end = std::chrono::steady_clock::now();
+	sink = sum;
+	double const ops = double(repetitions) * double(words);
+	double const ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+	if (counter.available()) {
+		std::printf("%-7s %-40s %8.3f ns/op %8.2f instructions/op\n", word, name, ns / ops, double(instructions) / ops);
+	} else {
+		std::printf("%-7s %-40s %8.3f ns/op %8s instructions/op\n", word, name, ns / ops, "-");
+	}
+}
+
+template<typename UINT>
+union Reg {
+	psbf::detail::allbits<UINT> word;
+	psbf::bitfield<1,4,UINT> field;
+	psbf::bitfield<5,3,UINT> other;
+};
+template<typename UINT>
+struct Native {
+	UINT low:1;
+	UINT field:4;
+	UINT other:3;
+};
+template<typename UINT>
+struct manual {
+	static constexpr UINT fieldmask = 0xFu << 1;
+	static constexpr UINT othermask = 0x7u << 5;
+	static UINT field(UINT word) { return UINT((word >> 1) & 0xFu); }
+	static UINT place(UINT field, UINT other) { return UINT((field & 0xFu) << 1 | (other & 0x7u) << 5); }
+	static UINT setfield(UINT word, UINT field) { return UINT((word & UINT(~fieldmask)) | (field & 0xFu) << 1); }
+};
+
+template<typename UINT, typename REG, typename NATIVE, typename PLAIN>
+void run_all(char const *word, REG *regs, NATIVE *natives, PLAIN *plain, char const *kind){
+	using m = manual<UINT>;
+	char name[64];
+	auto const label = [&](char const *what){ std::snprintf(name, sizeof(name), "%s %s", what, kind); return name; };
+
+	run(word, label("read psbf"), [=]{
+		uint64_t sum{};
+		for (std::size_t i = 0; i < words; ++i) sum += regs[i].field;
+		return sum;
+	});
+	run(word, label("read native"), [=]{
+		uint64_t sum{};
+		for (std::size_t i = 0; i < words; ++i) sum += natives[i].field;
+		return sum;
+	});
+	run(word, label("read manual"), [=]{
+		uint64_t sum{};
+		for (std::size_t i = 0; i < words; ++i) sum += m::field(plain[i]);
+		return sum;
+	});
+
+	run(word, label("write psbf"), [=]{
+		for (std::size_t i = 0; i < words; ++i) regs[i].field = UINT(i & 0xFu);
+		return uint64_t{regs[words / 2].field};
+	});
+	run(word, label("write native"), [=]{
+		for (std::size_t i = 0; i < words; ++i) natives[i].field = UINT(i & 0xFu) & 0xFu;
+		return uint64_t{natives[words / 2].field};
+	});
+	run(word, label("write manual"), [=]{
+		for (std::size_t i = 0; i < words; ++i) plain[i] = m::setfield(plain[i], UINT(i & 0xFu));
+		return uint64_t{plain[words / 2]};
+	});
+
+	run(word, label("write 2 fields psbf::modify"), [=]{
+		for (std::size_t i = 0; i < words; ++i) {
+			psbf::modify(regs[i], psbf::value(regs[i].field, UINT(i & 0xFu)), psbf::value(regs[i].other, UINT(i & 0x7u)));
+		}
+		return uint64_t{regs[words / 2].field};
+	});
+	run(word, label("write 2 fields native"), [=]{
+		for (std::size_t i = 0; i < words; ++i) {
+			natives[i].field = UINT(i & 0xFu) & 0xFu;
+			natives[i].other = UINT(i & 0x7u) & 0x7u;
+		}
+		return uint64_t{natives[words / 2].field};
+	});
+	run(word, label("write 2 fields manual"), [=]{
+		for (std::size_t i = 0; i < words; ++i) {
+			plain[i] = UINT((plain[i] & UINT(~(m::fieldmask | m::othermask))) | m::place(UINT(i & 0xFu), UINT(i & 0x7u)));
+		}
+		return uint64_t{plain[words / 2]};
+	});
+}
+
+template<typename UINT>
+void bench(char const *word){
+	static_assert(sizeof(Native<UINT>) == sizeof(UINT));
+	auto regs = std::make_unique<Reg<UINT>[]>(words);
+	auto natives = std::make_unique<Native<UINT>[]>(words);
+	auto plain = std::make_unique<UINT[]>(words);
+	run_all<UINT>(word, regs.get(), natives.get(), plain.get(), "");
+	run_all<UINT>(word, static_cast<Reg<UINT> volatile *>(regs.get()), static_cast<Native<UINT> volatile *>(natives.get()),
+			static_cast<UINT volatile *>(plain.get()), "(volatile)");
+}
+
+}
+
+int main() {
+	std::printf("%zu words, %u repetitions\n", words, repetitions);
+	bench<uint8_t>("bits8");
+	bench<uint16_t>("bits16");
+	bench<uint32_t>("bits32");
+	bench<uint64_t>("bits64");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,69 @@
+#include "psbitfield.h"
+
+// representative accessors for checking the generated code, see src/PSBitFieldCodegen.sh.
+// Compiled with -O2 -DNDEBUG, each extern "C" function is disassembled and its instructions and
+// memory reads are counted. Each line "// codegen <function> <max instructions> <reads>" below
+// is an expectation for x86-64: at most max instructions including the return and exactly that many
+// reads of memory, 0 where the read must be elided, i.e., when all bits of the word are written.
+// update_bits* write a field with atomic_access, a compare-exchange loop (two reads), set_flag*, clear_flag*
+// and write_flag* a single locked or or and (one read), write_flag* selects one of both.
+// Run with: make codegen
+
+// codegen read_bits* 4 1
+// codegen read_flag* 3 1
+// codegen read_sbits* 4 1
+// codegen write_bits* 7 1
+// codegen write_word* 2 0
+// codegen modify_bits* 10 1
+// codegen modify_all_bits* 3 0
+// codegen update_bits* 9 2
+// codegen set_flag* 2 1
+// codegen clear_flag* 2 1
+// codegen write_flag* 4 1
+
+namespace {
+template<typename UINT, typename ACCESS=psbf::native_access>
+union Shared {
+	using access = ACCESS;
+	psbf::detail::allbits<UINT,ACCESS> word;
+	psbf::bitfield<1,4,UINT,ACCESS> field;
+	psbf::bitfield<5,1,UINT,ACCESS,bool> flag;
+};
+template<typename UINT>
+union Reg {
+	psbf::detail::allbits<UINT> word;
+	psbf::bitfield<1,4,UINT> field;
+	psbf::bitfield<5,3,UINT> other;
+	psbf::bitfield<0,1,UINT,psbf::native_access,bool> flag;
+	psbf::bitfield<1,4,UINT,psbf::native_access,std::make_signed_t<UINT>> signedfield;
+	psbf::bitfield<0,sizeof(UINT)*8-1,UINT> low;
+	psbf::bitfield<sizeof(UINT)*8-1,1,UINT> top;
+};
+}
+
+#define PSBF_CODEGEN(N) \
+extern "C" { \
+uint##N##_t read_bits##N(Reg<uint##N##_t> const &reg) { return reg.field; } \
+uint##N##_t read_bits##N##_volatile(Reg<uint##N##_t> const volatile &reg) { return reg.field; } \
+bool read_flag##N##_volatile(Reg<uint##N##_t> const volatile &reg) { return reg.flag; } \
+int##N##_t read_sbits##N##_volatile(Reg<uint##N##_t> const volatile &reg) { return reg.signedfield; } \
+void write_bits##N(Reg<uint##N##_t> &reg, uint##N##_t value) { reg.field = value; } \
+void write_bits##N##_volatile(Reg<uint##N##_t> volatile &reg, uint##N##_t value) { reg.field = value; } \
+uint##N##_t read_bits##N##_relaxed(Shared<uint##N##_t,psbf::relaxed_access> const &reg) { return reg.field; } \
+void update_bits##N##_relaxed(Shared<uint##N##_t,psbf::relaxed_access> &reg, uint##N##_t value) { reg.field = value; } \
+void set_flag##N##_relaxed(Shared<uint##N##_t,psbf::relaxed_access> &reg) { reg.flag.set(); } \
+void clear_flag##N##_relaxed(Shared<uint##N##_t,psbf::relaxed_access> &reg) { reg.flag.clear(); } \
+void write_flag##N##_relaxed(Shared<uint##N##_t,psbf::relaxed_access> &reg, bool value) { reg.flag = value; } \
+void write_word##N##_volatile(Reg<uint##N##_t> volatile &reg, uint##N##_t value) { reg.word = value; } \
+void modify_bits##N##_volatile(Reg<uint##N##_t> volatile &reg, uint##N##_t field, uint##N##_t other) { \
+	psbf::modify(reg, psbf::value(reg.field, field), psbf::value(reg.other, other)); \
+} \
+void modify_all_bits##N##_volatile(Reg<uint##N##_t> volatile &reg, uint##N##_t low) { \
+	psbf::modify(reg, psbf::value(reg.low, low), psbf::value(reg.top, uint##N##_t{1})); \
+} \
+}
+
+PSBF_CODEGEN(8)
+PSBF_CODEGEN(16)
+PSBF_CODEGEN(32)
+PSBF_CODEGEN(64)
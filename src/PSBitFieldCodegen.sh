@@ -0,0 +1,85 @@
+#!/bin/sh
+# checks the generated code of the accessors in an object file against the expectations in their source:
+# lines "// codegen <function> <max instructions> <reads>", where function may end with * to match a prefix.
+# Instructions are counted up to and including the first ret, reads are instructions with a memory source
+# operand or a memory destination they modify (lea and nop do not access memory). x86-64, AT&T syntax.
+# Usage: PSBitFieldCodegen.sh object-file source-file
+
+if [ $# -ne 2 ]; then
+	echo "usage: $0 object-file source-file" >&2
+	exit 2
+fi
+
+objdump -d --no-show-raw-insn "$1" | awk -v source="$2" '
+BEGIN {
+	while ((getline line < source) > 0) {
+		if (split(line, field, " ") == 5 && field[1] == "//" && field[2] == "codegen") {
+			expected[++expectations] = field[3]
+			maxinstructions[expectations] = field[4]
+			reads[expectations] = field[5]
+		}
+	}
+	if (expectations == 0) {
+		print "no expectations in " source > "/dev/stderr"
+		exit 2
+	}
+}
+# operands split at commas outside of parentheses
+function operands(text, result,   n, depth, i, c, current) {
+	n = 0; depth = 0; current = ""
+	for (i = 1; i <= length(text); ++i) {
+		c = substr(text, i, 1)
+		if (c == "(") ++depth
+		if (c == ")") --depth
+		if (c == "," && depth == 0) { result[++n] = current; current = ""; continue }
+		current = current c
+	}
+	if (current != "") result[++n] = current
+	return n
+}
+function reads_memory(mnemonic, text,   op, n, i) {
+	if (mnemonic ~ /^(lea|nop)/) return 0
+	n = operands(text, op)
+	for (i = 1; i < n; ++i) if (op[i] ~ /\(/) return 1
+	# a memory destination is read too, unless it is only written
+	return n > 0 && op[n] ~ /\(/ && mnemonic !~ /^(mov|set)/ && n > 1
+}
+/^[0-9a-f]+ <[^>]+>:$/ {
+	name = $2; gsub(/[<>:]/, "", name)
+	functions[++count] = name
+	instructions[name] = 0; memreads[name] = 0; done[name] = 0
+	next
+}
+/^ +[0-9a-f]+:\t/ {
+	if (name == "" || done[name]) next
+	split($0, column, "\t")
+	mnemonic = column[2]; text = ""
+	if (match(mnemonic, / +/)) { text = substr(mnemonic, RSTART + RLENGTH); mnemonic = substr(mnemonic, 1, RSTART - 1) }
+	sub(/ *#.*$/, "", text)
+	++instructions[name]
+	memreads[name] += reads_memory(mnemonic, text)
+	if (mnemonic ~ /^ret/) done[name] = 1
+}
+END {
+	if (expectations == 0) exit 2
+	failed = 0
+	printf "%-32s %12s %6s\n", "function", "instructions", "reads"
+	for (i = 1; i <= count; ++i) {
+		name = functions[i]
+		for (e = 1; e <= expectations; ++e) {
+			pattern = expected[e]
+			if (pattern == name || (pattern ~ /\*$/ && index(name, substr(pattern, 1, length(pattern) - 1)) == 1)) break
+		}
+		if (e > expectations) continue
+		matched[e] = 1
+		verdict = ""
+		if (instructions[name] > maxinstructions[e]) verdict = verdict " more than " maxinstructions[e] " instructions"
+		if (memreads[name] != reads[e]) verdict = verdict " expected " reads[e] " reads"
+		printf "%-32s %12d %6d%s\n", name, instructions[name], memreads[name], verdict == "" ? "" : "  FAILED:" verdict
+		if (verdict != "") failed = 1
+	}
+	for (e = 1; e <= expectations; ++e) {
+		if (! matched[e]) { print "no function for expectation " expected[e]; failed = 1 }
+	}
+	exit failed
+}'
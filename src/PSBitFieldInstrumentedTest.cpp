@@ -0,0 +1,238 @@
+// tests of the instrumentation of field accesses, built with -DPSBF_COUNT_ACCESSES -DPSBF_TRACE_ACCESSES, see Makefile
+#include "psbitfield.h"
+#include "psbitfield_counts.h"
+#include "psbitfield_trace.h"
+#include "cute.h"
+#include <algorithm>
+#include "ide_listener.h"
+#include "xml_listener.h"
+#include "cute_runner.h"
+
+#if ! defined(PSBF_COUNT_ACCESSES) || ! defined(PSBF_TRACE_ACCESSES)
+#error "build with -DPSBF_COUNT_ACCESSES -DPSBF_TRACE_ACCESSES"
+#endif
+
+namespace {
+union Reg {
+	psbf::allbits32 word;
+	psbf::bits32<0,4> mode;
+	psbf::bits32<4,8> count;
+	psbf::flag32<31> start;
+	psbf::scattered<psbf::bits32<12,4>, psbf::bits32<24,4>> split;
+};
+
+// a policy providing a read-modify-write in one step for volatile words
+struct update_access : psbf::native_access {
+	template<typename UINT, typename CHANGE>
+	static UINT update(UINT volatile &word, CHANGE change) {
+		UINT const old = word;
+		word = UINT(change(old));
+		return old;
+	}
+};
+static_assert(psbf::detail::has_update<update_access, uint32_t volatile>::value);
+union UpdatedReg {
+	using access = update_access;
+	psbf::detail::allbits<uint32_t,update_access> word;
+	psbf::bitfield<0,4,uint32_t,update_access> mode;
+	psbf::bitfield<4,8,uint32_t,update_access> count;
+};
+// a word shared between threads, accessed as std::atomic_ref
+union SharedReg {
+	using access = psbf::relaxed_access;
+	psbf::bitfield<0,32,uint32_t,access> word;
+	psbf::bitfield<0,4,uint32_t,access> mode;
+	psbf::bitfield<4,8,uint32_t,access> count;
+	psbf::bitfield<31,1,uint32_t,access,bool> start;
+};
+
+psbf::access_count count_of(void const volatile *word, uint64_t mask){
+	auto const counts = psbf::access_counts();
+	auto const it = std::find_if(counts.begin(), counts.end(), [=](auto const &c){ return c.word == word && c.mask == mask; });
+	return it == counts.end() ? psbf::access_count{word, 0, mask, 0, 0} : *it;
+}
+}
+
+namespace accesscounts {
+void testFieldWriteCountsReadAndWriteOfField(){
+	Reg volatile reg{};
+	psbf::reset_access_counts();
+	reg.count = 42;
+	auto const counts = psbf::access_counts();
+	ASSERT_EQUAL(1u, counts.size());
+	ASSERT_EQUAL(32u, counts[0].wordsize);
+	ASSERT_EQUAL(0xff0u, counts[0].mask);
+	ASSERT_EQUAL(4u, counts[0].from());
+	ASSERT_EQUAL(8u, counts[0].width());
+	ASSERT_EQUAL(1u, counts[0].reads);
+	ASSERT_EQUAL(1u, counts[0].writes);
+}
+void testFieldReadCountsReadOfField(){
+	Reg volatile reg{};
+	psbf::reset_access_counts();
+	ASSERT(not reg.start);
+	auto const start = count_of(&reg, 0x8000'0000u);
+	ASSERT_EQUAL(1u, start.reads);
+	ASSERT_EQUAL(0u, start.writes);
+	ASSERT_EQUAL(31u, start.from());
+	ASSERT_EQUAL(1u, start.width());
+}
+void testModifyCountsEachField(){
+	Reg volatile reg{};
+	psbf::reset_access_counts();
+	psbf::modify(reg, psbf::value(reg.mode, 3u), psbf::value(reg.count, 7u));
+	ASSERT_EQUAL(2u, psbf::access_counts().size());
+	auto const mode = count_of(&reg, 0xfu);
+	ASSERT_EQUAL(1u, mode.reads);
+	ASSERT_EQUAL(1u, mode.writes);
+	auto const count = count_of(&reg, 0xff0u);
+	ASSERT_EQUAL(1u, count.reads);
+	ASSERT_EQUAL(1u, count.writes);
+}
+void testSnapshotCountsReadOfAllBits(){
+	Reg volatile reg{};
+	psbf::reset_access_counts();
+	auto const copy = psbf::snapshot(reg);
+	ASSERT_EQUAL(0u, copy.mode + copy.count);
+	auto const counts = psbf::access_counts();
+	ASSERT_EQUAL(1u, counts.size());
+	ASSERT_EQUAL(0xffff'ffffu, counts[0].mask);
+	ASSERT_EQUAL(1u, counts[0].reads);
+	ASSERT_EQUAL(0u, counts[0].writes);
+}
+void testAtomicAccessCountsReadAndWriteOfField(){
+	SharedReg reg{};
+	psbf::reset_access_counts();
+	reg.count = 42;
+	ASSERT_EQUAL(42u, reg.count);
+	auto const count = count_of(&reg, 0xff0u);
+	ASSERT_EQUAL(2u, count.reads);
+	ASSERT_EQUAL(1u, count.writes);
+}
+void testScatteredFieldIsCountedByItsMask(){
+	Reg volatile reg{};
+	psbf::reset_access_counts();
+	reg.split = 0xabu;
+	ASSERT_EQUAL(0xabu, reg.split);
+	auto const counts = psbf::access_counts();
+	ASSERT_EQUAL(1u, counts.size());
+	ASSERT_EQUAL(0x0f00'f000u, counts[0].mask);
+	ASSERT(not counts[0].contiguous());
+	ASSERT_EQUAL(2u, counts[0].reads);
+	ASSERT_EQUAL(1u, counts[0].writes);
+}
+}
+
+namespace traces {
+void assertRecord(void const volatile *word, uint64_t mask, uint64_t value, bool write, psbf::trace_record const &record){
+	ASSERT_EQUAL(reinterpret_cast<std::uintptr_t>(word), record.address());
+	ASSERT_EQUAL(4u, record.size());
+	ASSERT_EQUAL(mask, record.mask);
+	ASSERT_EQUAL(value, record.word);
+	ASSERT_EQUAL(write, record.write());
+}
+void testFieldWriteRecordsReadAndWriteOfField(){
+	Reg volatile reg{{0x8000'0001u}};
+	psbf::reset_trace();
+	reg.count = 42;
+	auto const records = psbf::trace_records();
+	ASSERT_EQUAL(2u, records.size());
+	assertRecord(&reg, 0xff0u, 0x8000'0001u, false, records[0]);
+	assertRecord(&reg, 0xff0u, 0x8000'02a1u, true, records[1]);
+}
+void testFieldReadRecordsWordRead(){
+	Reg volatile reg{{0x8000'0001u}};
+	psbf::reset_trace();
+	ASSERT(reg.start);
+	auto const records = psbf::trace_records();
+	ASSERT_EQUAL(1u, records.size());
+	assertRecord(&reg, 0x8000'0000u, 0x8000'0001u, false, records[0]);
+}
+void testModifyRecordsMaskOfAllFields(){
+	Reg volatile reg{{0x8000'0000u}};
+	psbf::reset_trace();
+	psbf::modify(reg, psbf::value(reg.mode, 3u), psbf::value(reg.count, 7u));
+	auto const records = psbf::trace_records();
+	ASSERT_EQUAL(2u, records.size());
+	assertRecord(&reg, 0xfffu, 0x8000'0000u, false, records[0]);
+	assertRecord(&reg, 0xfffu, 0x8000'0073u, true, records[1]);
+}
+void testSnapshotRecordsReadOfAllBits(){
+	Reg volatile reg{{0x1234'5678u}};
+	psbf::reset_trace();
+	auto const copy = psbf::snapshot(reg);
+	ASSERT_EQUAL(0x67u, copy.count);
+	auto const records = psbf::trace_records();
+	ASSERT_EQUAL(1u, records.size());
+	assertRecord(&reg, 0xffff'ffffu, 0x1234'5678u, false, records[0]);
+}
+void testUpdateRecordsPreviousAndNewWord(){
+	UpdatedReg volatile reg{{0xf00f'0001u}};
+	psbf::reset_trace();
+	reg.count = 0xabu;
+	auto const records = psbf::trace_records();
+	ASSERT_EQUAL(2u, records.size());
+	assertRecord(&reg, 0xff0u, 0xf00f'0001u, false, records[0]);
+	assertRecord(&reg, 0xff0u, 0xf00f'0ab1u, true, records[1]);
+	ASSERT_EQUAL(0xf00f'0ab1u, reg.word);
+}
+void testAtomicUpdateRecordsPreviousAndNewWord(){
+	SharedReg reg{{0xf00f'0001u}};
+	psbf::reset_trace();
+	reg.count = 0xabu;
+	auto const records = psbf::trace_records();
+	ASSERT_EQUAL(2u, records.size());
+	assertRecord(&reg, 0xff0u, 0xf00f'0001u, false, records[0]);
+	assertRecord(&reg, 0xff0u, 0xf00f'0ab1u, true, records[1]);
+}
+void testAtomicSetRecordsPreviousAndNewWord(){
+	SharedReg reg{{0x1u}};
+	psbf::reset_trace();
+	ASSERT(not reg.start.test_and_set());
+	reg.start.clear();
+	auto const records = psbf::trace_records();
+	ASSERT_EQUAL(4u, records.size());
+	assertRecord(&reg, 0x8000'0000u, 0x1u, false, records[0]);
+	assertRecord(&reg, 0x8000'0000u, 0x8000'0001u, true, records[1]);
+	assertRecord(&reg, 0x8000'0000u, 0x8000'0001u, false, records[2]);
+	assertRecord(&reg, 0x8000'0000u, 0x1u, true, records[3]);
+}
+void testAtomicSnapshotRecordsReadOfAllBits(){
+	SharedReg reg{{0x1234'5678u}};
+	psbf::reset_trace();
+	auto const copy = psbf::snapshot(reg);
+	auto const records = psbf::trace_records();
+	ASSERT_EQUAL(1u, records.size());
+	assertRecord(&reg, 0xffff'ffffu, 0x1234'5678u, false, records[0]);
+	ASSERT_EQUAL(0x8u, copy.mode);
+}
+}
+
+bool runAllTests(int argc, char const *argv[]) {
+	cute::suite s { };
+	s.push_back(CUTE(accesscounts::testFieldWriteCountsReadAndWriteOfField));
+	s.push_back(CUTE(accesscounts::testFieldReadCountsReadOfField));
+	s.push_back(CUTE(accesscounts::testModifyCountsEachField));
+	s.push_back(CUTE(accesscounts::testSnapshotCountsReadOfAllBits));
+	s.push_back(CUTE(accesscounts::testAtomicAccessCountsReadAndWriteOfField));
+	s.push_back(CUTE(accesscounts::testScatteredFieldIsCountedByItsMask));
+	s.push_back(CUTE(traces::testFieldWriteRecordsReadAndWriteOfField));
+	s.push_back(CUTE(traces::testFieldReadRecordsWordRead));
+	s.push_back(CUTE(traces::testModifyRecordsMaskOfAllFields));
+	s.push_back(CUTE(traces::testSnapshotRecordsReadOfAllBits));
+	s.push_back(CUTE(traces::testUpdateRecordsPreviousAndNewWord));
+	s.push_back(CUTE(traces::testAtomicUpdateRecordsPreviousAndNewWord));
+	s.push_back(CUTE(traces::testAtomicSetRecordsPreviousAndNewWord));
+	s.push_back(CUTE(traces::testAtomicSnapshotRecordsReadOfAllBits));
+	cute::xml_file_opener xmlfile(argc, argv);
+	cute::xml_listener<cute::ide_listener<>> lis(xmlfile.out);
+	auto runner = cute::makeRunner(lis, argc, argv);
+	bool success = runner(s, "InstrumentedTests");
+	psbf::reset_access_counts();
+	psbf::reset_trace();
+	return success;
+}
+
+int main(int argc, char const *argv[]) {
+    return runAllTests(argc, argv) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
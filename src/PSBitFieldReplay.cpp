@@ -0,0 +1,40 @@
+#include "psbitfield_sim.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// replays a trace recorded with PSBF_TRACE_ACCESSES against a simulated device with the given latency per access,
+// to compare the bus time of access patterns.
+// Usage: PSBitFieldReplay trace-file base-address device-size [latency-ns]
+// base-address is the address of the device's first register in the traced program, e.g., 0x7f3c2a001000.
+// Run with: make replay TRACE=trace-file BASE=base-address SIZE=device-size
+
+int main(int argc, char *argv[]) {
+	if (argc < 4 || argc > 5) {
+		std::fprintf(stderr, "usage: %s trace-file base-address device-size [latency-ns]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	std::FILE *in = std::fopen(argv[1], "rb");
+	if (! in) {
+		std::perror(argv[1]);
+		return EXIT_FAILURE;
+	}
+	auto const records = psbf::load_trace(in);
+	std::fclose(in);
+	auto const base = std::uintptr_t(std::strtoull(argv[2], nullptr, 0));
+	auto const size = std::size_t(std::strtoull(argv[3], nullptr, 0));
+	auto const latency = std::chrono::nanoseconds{argc == 5 ? std::strtoll(argv[4], nullptr, 0) : 0};
+
+	psbf::simulated_device dev{size, latency};
+	auto const start = std::chrono::steady_clock::now();
+	std::size_t const replayed = psbf::replay(records, dev, base);
+	auto const end = std::chrono::steady_clock::now();
+
+	std::printf("%zu records, %zu replayed: %zu reads, %zu writes\n", records.size(), replayed, dev.reads(), dev.writes());
+	std::printf("bus time %lld ns, replay took %lld ns\n", static_cast<long long>(dev.busy().count()),
+			static_cast<long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+	if (! records.empty()) {
+		std::printf("traced time %llu ticks\n", static_cast<unsigned long long>(records.back().timestamp - records.front().timestamp));
+	}
+	return EXIT_SUCCESS;
+}
@@ -1,17 +1,28 @@
 #include "psbitfield.h"
+#include "psbitfield_regmap.h"
+#include "psbitfield_packed.h"
+#include "psbitfield_simd.h"
+#include "psbitfield_wide.h"
+#include "psbitfield_stream.h"
+#include "psbitfield_sim.h"
+#include "psbitfield_counts.h"
+#include "psbitfield_trace.h"
 #include "cute.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
 #include "ide_listener.h"
 #include "xml_listener.h"
 #include "cute_runner.h"
 
 namespace psbf {
-template<uint8_t from, uint8_t width, typename UINT>
-std::ostream & operator<<(std::ostream &out, bitfield<from,width,UINT> const volatile &me){
-	return out << static_cast<typename bitfield<from,width,UINT>::expr_type>(me);
+template<uint8_t from, uint8_t width, typename UINT, typename ACCESS>
+std::ostream & operator<<(std::ostream &out, bitfield<from,width,UINT,ACCESS> const volatile &me){
+	return out << static_cast<typename bitfield<from,width,UINT,ACCESS>::expr_type>(me);
 }
-template<uint8_t from, uint8_t width, typename UINT>
-std::ostream & operator<<(std::ostream &out, bitfield<from,width,UINT> const  &me){
-	return out << static_cast<typename bitfield<from,width,UINT>::expr_type>(me);
+template<uint8_t from, uint8_t width, typename UINT, typename ACCESS>
+std::ostream & operator<<(std::ostream &out, bitfield<from,width,UINT,ACCESS> const  &me){
+	return out << static_cast<typename bitfield<from,width,UINT,ACCESS>::expr_type>(me);
 }
 
 }
@@ -259,6 +270,1004 @@ void testWritingMultipleFieldsInAllClearBitsSetsBits(){
 
 }
 
+namespace batched {
+void testModifySetsAllFieldsAtOnce(){
+	TestField32 volatile field{};
+	psbf::modify(field, psbf::value(field.firstnibble, 0b1010u), psbf::value(field.threebits, 0b10u), psbf::value(field.ashort, 0xAFFEu));
+	ASSERT_EQUAL(0xAFFE'004Au,field.word);
+}
+void testModifyKeepsOtherFields(){
+	TestField32 field{{0xffff'ffffu}};
+	psbf::modify(field, psbf::value(field.fourthbit, 0u), psbf::value(field.secondbyte, 0x42u));
+	ASSERT_EQUAL(0xffff'42efu,field.word);
+}
+void testModifySingleField(){
+	b8::TestField volatile field{{0xffu}};
+	psbf::modify(field, psbf::value(field.threebits, 0b010u));
+	ASSERT_EQUAL(0x5fu,field.word);
+}
+void testModifyChecksFieldsOfUnion(){
+	using nibble = decltype(TestField32::firstnibble);
+	static_assert(0u == psbf::detail::overlap_of<unsigned>(nibble::mask, decltype(TestField32::fourthbit)::mask));
+	static_assert(0xfu == psbf::detail::overlap_of<unsigned>(nibble::mask, nibble::mask)); // given twice
+	static_assert(psbf::detail::field_of<TestField32 volatile, nibble>());
+	static_assert(not psbf::detail::field_of<b8::TestField, nibble>());
+	TestField32 field{}, other{};
+	ASSERT(psbf::detail::given_for(field, psbf::value(field.ashort, 1u)));
+	ASSERT(not psbf::detail::given_for(other, psbf::value(field.ashort, 1u)));
+	ASSERT(psbf::detail::given_for(other, psbf::fieldvalue<nibble>{1u})); // no field to check
+}
+}
+
+namespace composing {
+void testComposeIsConstexpr(){
+	constexpr auto value = psbf::compose<TestField32>{}.set<&TestField32::firstnibble>(0b1010u).set<&TestField32::ashort>(0xAFFEu);
+	static_assert(value.value() == 0xAFFE'000Au);
+	ASSERT_EQUAL(0xAFFE'000Au, value.value());
+}
+void testComposeStoreDoesNotKeepOldBits(){
+	TestField32 volatile field{{0xffff'ffffu}};
+	psbf::compose<TestField32>{}.set<&TestField32::fourthbit>(1u).set<&TestField32::secondbyte>(0x42u).store(field);
+	ASSERT_EQUAL(0x42'10u,field.word);
+}
+void testComposeStartsFromResetValue(){
+	b16::TestField field{};
+	psbf::compose<b16::TestField>{0xA500u}.set(psbf::value(field.firstnibble, 0xfu)).store(field);
+	ASSERT_EQUAL(0xA50fu,field.word);
+}
+}
+
+namespace snapshots {
+void testSnapshotCopiesAllFields(){
+	TestField32 volatile field{{0xAFFE'A55Au}};
+	auto const copy = psbf::snapshot(field);
+	static_assert(std::is_same_v<decltype(copy), TestField32 const>);
+	ASSERT_EQUAL(0xAu, copy.firstnibble);
+	ASSERT_EQUAL(1u, copy.fourthbit);
+	ASSERT_EQUAL(0b10u, copy.threebits);
+	ASSERT_EQUAL(0xA5u, copy.secondbyte);
+	ASSERT_EQUAL(0xAFFEu, copy.ashort);
+}
+void testSnapshotIsNotAffectedByLaterWrites(){
+	b64::TestField volatile field{{0xDEAD'BEEF'0000'0000u}};
+	auto const copy = psbf::snapshot(field);
+	field.dword = 0u;
+	ASSERT_EQUAL(0xDEAD'BEEFu, copy.dword);
+	ASSERT_EQUAL(0u, field.dword);
+}
+}
+
+namespace shadows {
+void testShadowWritesOnlyOnFlush(){
+	TestField32 volatile field{{0xffff'0000u}};
+	psbf::shadowed<TestField32> shadow{field};
+	shadow.set<&TestField32::firstnibble>(0xAu);
+	shadow.set(psbf::value(shadow->secondbyte, 0xA5u));
+	ASSERT_EQUAL(0xffff'0000u, field.word);
+	ASSERT_EQUAL(0xA5u, shadow->secondbyte);
+	ASSERT_EQUAL(0xff0fu, shadow.dirty());
+	ASSERT(shadow.flush());
+	ASSERT_EQUAL(0xffff'A50Au, field.word);
+	ASSERT_EQUAL(0u, shadow.dirty());
+}
+void testCleanShadowDoesNotFlush(){
+	b16::TestField volatile field{{0x1234u}};
+	psbf::shadowed<b16::TestField> shadow{field, 0u};
+	field.word = 0x5678u;
+	ASSERT(not shadow.flush());
+	ASSERT_EQUAL(0x5678u, field.word);
+	shadow.write();
+	ASSERT_EQUAL(0u, field.word);
+}
+void testShadowSetsValuesOfRegisterOrCopy(){
+	b16::TestField volatile field{};
+	psbf::shadowed<b16::TestField> shadow{field};
+	shadow.set(psbf::value(field.firstnibble, 0x3u));
+	shadow.set(psbf::value(shadow->secondbyte, 0x12u));
+	shadow.flush();
+	ASSERT_EQUAL(0x1203u, field.word);
+}
+void testShadowReloadDiscardsChanges(){
+	b8::TestField volatile field{{0x0fu}};
+	psbf::shadowed<b8::TestField> shadow{field};
+	shadow.set<&b8::TestField::threebits>(0b111u);
+	field.word = 0x10u;
+	shadow.reload();
+	ASSERT_EQUAL(0u, shadow.dirty());
+	ASSERT_EQUAL(0x10u, shadow->word);
+}
+}
+
+namespace registerblocks {
+struct Device {
+	TestField32 ctrl;
+	b16::TestField mode;
+	b8::TestField flags;
+	uint8_t reserved;
+	b64::TestField data;
+};
+using DeviceBlock = psbf::register_block<
+		psbf::reg_at<0, TestField32>,
+		psbf::reg_at<4, b16::TestField>,
+		psbf::reg_at<6, b8::TestField>,
+		psbf::reg_at<8, b64::TestField>>;
+static_assert(DeviceBlock::size == sizeof(Device));
+
+void testRegisterBlockAccessesRegistersAtOffsets(){
+	Device volatile device{};
+	DeviceBlock block{&device};
+	block.get<0>().ashort = 0xAFFEu;
+	block.get<2>().fourthbit.set();
+	block.get<3>().dword = 0xDEAD'BEEFu;
+	ASSERT_EQUAL(0xAFFE'0000u, device.ctrl.word);
+	ASSERT_EQUAL(0x10u, device.flags.word);
+	ASSERT_EQUAL(0xDEAD'BEEF'0000'0000u, device.data.word);
+}
+void testRegisterBlockSaveAndRestore(){
+	Device volatile device{{{0x1234'5678u}}, {{0xA55Au}}, {{0x42u}}, 0xffu, {{0x0123'4567'89AB'CDEFu}}};
+	DeviceBlock block{&device};
+	DeviceBlock::image saved{};
+	block.save(saved);
+	ASSERT(block.matches(saved));
+	device.ctrl.word = 0u;
+	device.data.word = 0u;
+	ASSERT(not block.matches(saved));
+	block.restore(saved);
+	ASSERT_EQUAL(0x1234'5678u, device.ctrl.word);
+	ASSERT_EQUAL(0xA55Au, device.mode.word);
+	ASSERT_EQUAL(0x42u, device.flags.word);
+	ASSERT_EQUAL(0xffu, device.reserved);
+	ASSERT_EQUAL(0x0123'4567'89AB'CDEFu, device.data.word);
+}
+void testRegisterBlockRestoreChangedWritesOnlyDifferences(){
+	Device volatile device{};
+	DeviceBlock block{&device};
+	DeviceBlock::image reset{};
+	block.save(reset);
+	DeviceBlock::image wanted{reset};
+	block.get<1>().secondbyte = 0x42u;
+	block.save(wanted);
+	block.restore(reset);
+	ASSERT(wanted != reset);
+	ASSERT_EQUAL(1u, block.restore_changed(wanted, reset));
+	ASSERT(block.matches(wanted));
+}
+}
+
+namespace packed {
+void testPackedValuesStraddleWords(){
+	psbf::packed_vector<12> values(100);
+	ASSERT_EQUAL(100u, values.size());
+	ASSERT_EQUAL(19u, values.word_count());
+	for (unsigned i=0; i < values.size(); ++i) values[i] = (i * 41u) & 0xfffu;
+	for (unsigned i=0; i < values.size(); ++i) ASSERT_EQUAL((i * 41u) & 0xfffu, values[i]);
+	ASSERT_EQUAL(0u, values.data()[18] >> 48); // 1200 bits used
+}
+void testPackedSetKeepsNeighbours(){
+	psbf::packed_vector<3, uint8_t> values(8, 0b111u);
+	values[2] = 0b010u; // bits 6..8 straddle the first byte
+	ASSERT_EQUAL(0b10'111'111u, unsigned{values.data()[0]});
+	ASSERT_EQUAL(0b1'111'111'0u, unsigned{values.data()[1]});
+	ASSERT_EQUAL(0b111u, values[1]);
+	ASSERT_EQUAL(0b010u, values[2]);
+	ASSERT_EQUAL(0b111u, values[3]);
+}
+void testPackedFillClearsUnusedBits(){
+	psbf::packed_vector<5, uint16_t> values(7);
+	values.fill(0b10101u);
+	ASSERT(std::all_of(values.begin(), values.end(), [](unsigned v){ return v == 0b10101u; }));
+	ASSERT_EQUAL(0b101u, unsigned{values.data()[2]}); // 35 bits used
+}
+void testPackedIteratorsAndPushBack(){
+	psbf::packed_vector<7> values{};
+	for (unsigned i=0; i < 20; ++i) values.push_back(i);
+	std::reverse(values.begin(), values.end());
+	ASSERT_EQUAL(19u, *values.cbegin());
+	ASSERT_EQUAL(20, values.end() - values.begin());
+	ASSERT_EQUAL(0u, values.begin()[19]);
+	psbf::packed_vector<7> other(20);
+	std::copy(values.cbegin(), values.cend(), other.begin());
+	ASSERT(values == other);
+}
+}
+
+namespace bulk {
+// n pseudo-random words (splitmix64), the same for the same seed
+template<typename UINT>
+std::vector<UINT> random_words(std::size_t n, uint64_t seed){
+	std::vector<UINT> words(n);
+	for (auto &w : words) {
+		uint64_t z = (seed += 0x9E37'79B9'7F4A'7C15u);
+		z = (z ^ (z >> 30)) * 0xBF58'476D'1CE4'E5B9u;
+		z = (z ^ (z >> 27)) * 0x94D0'49BB'1331'11EBu;
+		w = UINT(z ^ (z >> 31));
+	}
+	return words;
+}
+// the bulk operations are checked with each, ISAs the CPU lacks fall back to the best one available
+constexpr psbf::simd_isa all_isas[]{psbf::simd_isa::scalar, psbf::simd_isa::avx2, psbf::simd_isa::avx512};
+
+template<typename FIELD>
+void checkExtractAllOnAllIsas(){
+	using word = typename FIELD::result_type;
+	auto const words = random_words<word>(203, 1u);
+	for (auto isa : all_isas) {
+		std::vector<word> values(words.size());
+		psbf::extract_all<FIELD>(words, values, isa);
+		for (std::size_t i = 0; i < words.size(); ++i) {
+			ASSERT_EQUAL(FIELD::extract(words[i]), values[i]);
+		}
+	}
+}
+template<typename FIELD>
+void checkInsertAllOnAllIsas(){
+	using word = typename FIELD::result_type;
+	auto const original = random_words<word>(203, 2u);
+	auto values = random_words<word>(original.size(), 3u);
+	for (auto &value : values) value = word(value & FIELD::widthmask);
+	for (auto isa : all_isas) {
+		std::vector<word> words{original};
+		psbf::insert_all<FIELD>(words, values, isa);
+		for (std::size_t i = 0; i < words.size(); ++i) {
+			ASSERT_EQUAL(values[i], FIELD::extract(words[i]));
+			ASSERT_EQUAL(original[i] & ~FIELD::mask, words[i] & ~FIELD::mask);
+		}
+	}
+}
+void testInsertAll(){
+	checkInsertAllOnAllIsas<psbf::bits8<5,3>>();
+	checkInsertAllOnAllIsas<psbf::bits16<3,9>>();
+	checkInsertAllOnAllIsas<decltype(TestField32::secondbyte)>();
+	checkInsertAllOnAllIsas<psbf::bits64<33,30>>();
+	checkInsertAllOnAllIsas<psbf::allbits64>();
+}
+void testExtractAll8(){
+	checkExtractAllOnAllIsas<psbf::bits8<5,3>>();
+	checkExtractAllOnAllIsas<psbf::bits8<0,4>>();
+}
+void testExtractAll16(){
+	checkExtractAllOnAllIsas<psbf::bits16<3,9>>();
+}
+void testExtractAll32(){
+	checkExtractAllOnAllIsas<decltype(TestField32::ashort)>();
+	checkExtractAllOnAllIsas<psbf::bits32<7,13>>();
+}
+void testExtractAll64(){
+	checkExtractAllOnAllIsas<psbf::bits64<33,30>>();
+	checkExtractAllOnAllIsas<psbf::allbits64>();
+}
+}
+
+namespace scatteredfields {
+union SplitReg {
+	template<uint8_t from, uint8_t width>
+	using bf=psbf::bits32<from,width>;
+	psbf::allbits32 word;
+	bf<0,8> low;
+	bf<24,4> high;
+	psbf::scattered<bf<0,8>, bf<24,4>> value;
+	psbf::scattered<bf<28,4>, bf<8,4>> swapped; // not ascending
+};
+constexpr unsigned constexprScatteredWrite(){
+	SplitReg reg{};
+	reg.value = 0xABCu;
+	return reg.value;
+}
+static_assert(constexprScatteredWrite() == 0xABCu);
+static_assert(decltype(SplitReg::value)::mask == 0x0F00'00FFu);
+static_assert(decltype(SplitReg::value)::bitwidth == 12);
+
+void testScatteredReadCombinesSlices(){
+	SplitReg volatile reg{{0x1A00'0BBCu}};
+	ASSERT_EQUAL(0xABCu, static_cast<unsigned>(reg.value));
+	ASSERT_EQUAL(0xB1u, static_cast<unsigned>(reg.swapped));
+}
+void testScatteredWriteSplitsValue(){
+	SplitReg volatile reg{{0xffff'ffffu}};
+	reg.value = 0x123u;
+	ASSERT_EQUAL(0xf1ff'ff23u, reg.word);
+	reg.swapped = 0x45u;
+	ASSERT_EQUAL(0x51ff'f423u, reg.word);
+}
+void testScatteredWithModify(){
+	SplitReg reg{};
+	psbf::modify(reg, psbf::value(reg.value, 0xABCu));
+	ASSERT_EQUAL(0x0A00'00BCu, reg.word);
+}
+}
+
+namespace wireviews {
+union IPv4Start {
+	template<uint8_t from, uint8_t width>
+	using bf=psbf::bits32<from,width>;
+	psbf::allbits32 word;
+	bf<28,4> version;
+	bf<24,4> ihl;
+	bf<18,6> dscp;
+	bf<16,2> ecn;
+	bf<0,16> length;
+};
+static_assert(psbf::detail::byteswap(uint32_t{0x1234'5678u}) == 0x7856'3412u);
+static_assert(psbf::detail::byteswap(uint16_t{0x1234u}) == 0x3412u);
+
+void testWireViewReadsBigEndianAtUnalignedPosition(){
+	std::byte const packet[]{std::byte{0xff}, std::byte{0x45}, std::byte{0x00}, std::byte{0x00}, std::byte{0x54}};
+	psbf::wire_view<IPv4Start, psbf::byteorder::big, std::byte const> header{packet + 1};
+	ASSERT_EQUAL(0x4500'0054u, header.word());
+	ASSERT_EQUAL(4u, header.get<&IPv4Start::version>());
+	ASSERT_EQUAL(5u, header.get<&IPv4Start::ihl>());
+	auto const copy = header.load();
+	ASSERT_EQUAL(0x54u, copy.length);
+}
+void testWireViewWritesBigEndian(){
+	std::byte packet[6]{};
+	psbf::wire_view<IPv4Start, psbf::byteorder::big> header{packet + 2};
+	header.set<&IPv4Start::version>(4u);
+	header.modify(psbf::fieldvalue<decltype(IPv4Start::ihl)>{5u}, psbf::fieldvalue<decltype(IPv4Start::length)>{0x1234u});
+	ASSERT_EQUAL(0x45u, std::to_integer<unsigned>(packet[2]));
+	ASSERT_EQUAL(0x00u, std::to_integer<unsigned>(packet[3]));
+	ASSERT_EQUAL(0x12u, std::to_integer<unsigned>(packet[4]));
+	ASSERT_EQUAL(0x34u, std::to_integer<unsigned>(packet[5]));
+	ASSERT_EQUAL(0u, std::to_integer<unsigned>(packet[1]));
+}
+void testWireViewLittleEndian(){
+	std::byte packet[3]{};
+	psbf::wire_view<b16::TestField, psbf::byteorder::little> header{packet + 1};
+	header.set<&b16::TestField::secondbyte>(0xA5u);
+	ASSERT_EQUAL(0xA5u, std::to_integer<unsigned>(packet[2]));
+	ASSERT_EQUAL(0xA500u, header.word());
+}
+}
+
+namespace byteorders {
+union BigEndian32 {
+	template<uint8_t from, uint8_t width>
+	using bf=psbf::bits32_be<from,width>;
+	psbf::allbits32_be word;
+	bf<0,4> firstnibble;
+	bf<4,1> fourthbit;
+	bf<8,8> secondbyte;
+	bf<16,16> ashort;
+};
+// the raw word as it appears in memory on this host
+uint32_t raw(BigEndian32 const volatile &reg){
+	return psbf::detail::wordof<psbf::allbits32>(reg);
+}
+uint32_t bigendian(uint32_t word){
+	return psbf::detail::convert<psbf::byteorder::big>(word);
+}
+
+void testBigEndianFieldsAreStoredSwapped(){
+	BigEndian32 volatile reg{};
+	reg.secondbyte = 0xA5u;
+	reg.firstnibble = 0xCu;
+	ASSERT_EQUAL(bigendian(0x0000'A50Cu), raw(reg));
+	ASSERT_EQUAL(0xA50Cu, reg.word);
+	ASSERT_EQUAL(0xA5u, reg.secondbyte);
+	reg.fourthbit.set();
+	ASSERT_EQUAL(0xA51Cu, reg.word);
+}
+void testBigEndianReadFromRawWord(){
+	BigEndian32 reg{{bigendian(0xAFFE'0010u)}};
+	ASSERT_EQUAL(0xAFFEu, reg.ashort);
+	ASSERT_EQUAL(1u, reg.fourthbit);
+	ASSERT_EQUAL(0u, reg.firstnibble);
+}
+void testBigEndianModifyAndCompose(){
+	BigEndian32 volatile reg{};
+	psbf::modify(reg, psbf::value(reg.ashort, 0xAFFEu), psbf::value(reg.firstnibble, 0x3u));
+	ASSERT_EQUAL(0xAFFE'0003u, reg.word);
+	constexpr auto value = psbf::compose<BigEndian32>{}.set<&BigEndian32::secondbyte>(0x42u);
+	static_assert(value.value() == psbf::detail::convert<psbf::byteorder::big>(uint32_t{0x4200u}));
+	value.store(reg);
+	ASSERT_EQUAL(0x4200u, reg.word);
+}
+}
+
+namespace widefields {
+union Descriptor {
+	template<uint16_t from, uint16_t width>
+	using bf=psbf::widebits<256,from,width>;
+	psbf::widewords<256> words;
+	bf<0,48> address;
+	bf<60,8> flags;
+	bf<64,64> second;
+	bf<120,16> straddle;
+	bf<128,128> tag;
+};
+static_assert(sizeof(Descriptor) == 32);
+static_assert(decltype(Descriptor::flags)::wordmask(0) == 0xF000'0000'0000'0000u);
+static_assert(decltype(Descriptor::flags)::wordmask(1) == 0xFu);
+
+void testWideFieldStraddlingWordsIsRead(){
+	Descriptor volatile desc{{{0xA000'0000'0000'0000u, 0xFFFF'FFFF'FFFF'FF05u, 0x1234u, 0u}}};
+	ASSERT_EQUAL(0x5Au, static_cast<uint64_t>(desc.flags));
+	ASSERT_EQUAL(0x34FFu, static_cast<uint64_t>(desc.straddle));
+	ASSERT_EQUAL(0u, static_cast<uint64_t>(desc.address));
+}
+void testWideFieldWriteTouchesOnlyItsBits(){
+	Descriptor volatile desc{{{~0ull, ~0ull, ~0ull, ~0ull}}};
+	desc.flags = 0x00u;
+	ASSERT_EQUAL(0x0FFF'FFFF'FFFF'FFFFu, desc.words[0]);
+	ASSERT_EQUAL(0xFFFF'FFFF'FFFF'FFF0u, desc.words[1]);
+	desc.second = 0x0123'4567'89AB'CDEFu;
+	ASSERT_EQUAL(0x0123'4567'89AB'CDEFu, desc.words[1]);
+	ASSERT_EQUAL(~0ull, desc.words[2]);
+}
+void testWideFieldWiderThan64Bits(){
+	Descriptor desc{};
+	using u128 = decltype(Descriptor::tag)::result_type;
+	static_assert(sizeof(u128) == 16);
+	desc.tag = (u128{0xDEAD'BEEFu} << 64) | 0xAFFEu;
+	ASSERT_EQUAL(0xAFFEu, desc.words[2]);
+	ASSERT_EQUAL(0xDEAD'BEEFu, desc.words[3]);
+	ASSERT(static_cast<u128>(desc.tag) >> 64 == 0xDEAD'BEEFu);
+}
+}
+
+namespace bitstreams {
+void testBitStreamPacksWithoutPadding(){
+	psbf::bit_ostream out;
+	out.put<4>(0xAu);
+	out.put(psbf::fieldvalue<decltype(TestField32::threebits)>{0b101u});
+	out.put<60>(0x0123'4567'89AB'CDEu);
+	ASSERT_EQUAL(67u, out.size());
+	auto const words = out.take();
+	ASSERT_EQUAL(2u, words.size());
+	ASSERT_EQUAL(0xDEu << 7 | 0b101u << 4 | 0xAu, words[0] & 0x7fffu);
+	ASSERT_EQUAL(0x0123'4567'89AB'CDEu >> 57, words[1]);
+	ASSERT_EQUAL(0u, out.size());
+}
+void testBitStreamRoundTrip(){
+	psbf::bit_ostream out;
+	for (unsigned i = 0; i < 100; ++i) {
+		out.write(i % 8, 3);
+		out.write(i * 977u, 17);
+		out.write(uint64_t{i} << 40 | i, 64);
+	}
+	auto const words = out.take();
+	ASSERT_EQUAL((100u * 84u + 63u) / 64u, words.size());
+	psbf::bit_istream in{words.data(), words.size()};
+	for (unsigned i = 0; i < 100; ++i) {
+		ASSERT_EQUAL(i % 8, in.read(3));
+		ASSERT_EQUAL(i * 977u, in.get<17>());
+		ASSERT_EQUAL(uint64_t{i} << 40 | i, in.read(64));
+	}
+	ASSERT_EQUAL(words.size() * 64 - 100u * 84u, in.remaining());
+}
+void testBitStreamFieldsOfUnion(){
+	TestField32 const record{{0xAFFE'A55Au}};
+	psbf::bit_ostream out;
+	out.put_fields<&TestField32::firstnibble, &TestField32::secondbyte, &TestField32::ashort>(record);
+	out.put_fields<&TestField32::fourthbit>(record);
+	ASSERT_EQUAL(29u, out.size());
+	auto const words = out.take();
+	psbf::bit_istream in{words.data(), words.size()};
+	TestField32 copy{};
+	in.get_fields<&TestField32::firstnibble, &TestField32::secondbyte, &TestField32::ashort, &TestField32::fourthbit>(copy);
+	ASSERT_EQUAL(0xAFFE'A51Au, copy.word);
+}
+}
+
+namespace signedfields {
+union Samples {
+	psbf::allbits32 word;
+	psbf::sbits32<0,12> sample;
+	psbf::sbits32<12,4> offset;
+	psbf::bits32<16,8> channel;
+	psbf::sbits32<24,8> gain;
+};
+static_assert(-2048 == decltype(Samples::sample)::minvalue);
+static_assert(2047 == decltype(Samples::sample)::maxvalue);
+void testSignedFieldSignExtends(){
+	Samples volatile s{{0x80'12'9'800u}};
+	ASSERT_EQUAL(-2048, int(s.sample));
+	ASSERT_EQUAL(-7, int(s.offset));
+	ASSERT_EQUAL(0x12u, s.channel);
+	ASSERT_EQUAL(-128, int(s.gain));
+	s.word = 0x7f'00'7'7ffu;
+	ASSERT_EQUAL(2047, int(s.sample));
+	ASSERT_EQUAL(7, int(s.offset));
+	ASSERT_EQUAL(127, int(s.gain));
+}
+void testSignedFieldAssignKeepsOtherBits(){
+	Samples volatile s{{0x00'AB'0'000u}};
+	s.sample = -1;
+	ASSERT_EQUAL(0x00'AB'0'FFFu, s.word);
+	s.offset = -8;
+	ASSERT_EQUAL(0x00'AB'8'FFFu, s.word);
+	s.gain = -2;
+	ASSERT_EQUAL(0xFE'AB'8'FFFu, s.word);
+	s.sample = 5;
+	ASSERT_EQUAL(5, int(s.sample));
+	ASSERT_EQUAL(0xFE'AB'8'005u, s.word);
+}
+void testSignedFieldsCombined(){
+	constexpr auto word = psbf::compose<Samples>{}.set<&Samples::sample>(-300).set<&Samples::gain>(-1).value();
+	static_assert(0xFF'00'0'000u + (4096u - 300u) == word);
+	Samples s{{word}};
+	psbf::modify(s, psbf::value(s.offset, -3), psbf::value(s.sample, 300));
+	ASSERT_EQUAL(0xFF'00'D'12Cu, s.word);
+	ASSERT_EQUAL(-3, int(psbf::snapshot(s).offset));
+}
+}
+
+namespace typedfields {
+enum class Mode : uint8_t { off, slow, fast, turbo };
+enum class Level : int8_t { low = -2, mid = 0, high = 1 };
+enum class Speed { stop, slow, fast, turbo }; // underlying type int
+}
+template<> struct psbf::signed_enum<typedfields::Level> : std::true_type {};
+namespace typedfields {
+union Control {
+	psbf::allbits16 word;
+	psbf::enumbits16<0,2,Mode> mode;
+	psbf::flag16<2> enable;
+	psbf::enumbits16<3,2,Level> level;
+	psbf::flag16<15> busy;
+};
+static_assert(std::is_same_v<Mode, decltype(Control::mode)::value_type>);
+static_assert(! std::is_assignable_v<decltype(Control::mode)&, unsigned>, "only Mode values");
+static_assert(Level::low == decltype(Control::level)::minvalue);
+union Drive {
+	psbf::allbits32 word;
+	psbf::enumbits32<0,2,Speed> speed;
+	psbf::enumbits32<2,2,Speed> limit;
+};
+static_assert(Speed::turbo == decltype(Drive::speed)::maxvalue);
+static_assert(Speed::stop == decltype(Drive::speed)::minvalue);
+void testEnumFieldReadsAndWritesEnum(){
+	Control volatile c{{0b101u}};
+	ASSERT(Mode::slow == c.mode);
+	c.mode = Mode::turbo;
+	ASSERT(Mode::turbo == c.mode);
+	ASSERT_EQUAL(0b111u, c.word);
+	c.level = Level::low;
+	ASSERT(Level::low == c.level);
+	ASSERT_EQUAL(0b10'1'11u, c.word);
+}
+void testEnumWithoutUnderlyingTypeIsUnsigned(){
+	Drive volatile d{};
+	d.speed = Speed::fast;
+	ASSERT(Speed::fast == d.speed);
+	d.limit = Speed::turbo;
+	ASSERT(Speed::turbo == d.limit);
+	ASSERT_EQUAL(0b11'10u, d.word);
+}
+void testFlagFieldIsBool(){
+	Control volatile c{{0x8000u}};
+	bool const busy = c.busy;
+	ASSERT(busy);
+	ASSERT(!c.enable);
+	c.enable = true;
+	ASSERT_EQUAL(0x8004u, c.word);
+	c.busy = false;
+	ASSERT_EQUAL(0x0004u, c.word);
+	ASSERT(c.enable.test_and_set());
+}
+void testTypedFieldsCombined(){
+	constexpr auto word = psbf::compose<Control>{}.set<&Control::mode>(Mode::fast).set<&Control::enable>(true).value();
+	static_assert(0b110u == word);
+	Control c{{word}};
+	psbf::modify(c, psbf::value(c.level, Level::high), psbf::value(c.busy, true));
+	ASSERT_EQUAL(0x8000u | 0b01'1'10u, c.word);
+	ASSERT(Level::high == psbf::snapshot(c).level);
+}
+}
+
+namespace fixedpoints {
+union Sensor {
+	psbf::allbits16 word;
+	psbf::fixedpoint<psbf::sbits16<0,16>,12> temperature; // Q4.12
+	psbf::fixedpoint<psbf::bits16<4,12>,4,double> level;  // unsigned 8.4
+};
+static_assert(1.0f / 4096 == decltype(Sensor::temperature)::resolution);
+void testFixedPointReadWrite(){
+	Sensor volatile s{{0x1800u}};
+	ASSERT_EQUAL_DELTA(1.5f, float(s.temperature), 0.0f);
+	s.temperature = -2.25f;
+	ASSERT_EQUAL(0xDC00u, s.word);
+	ASSERT_EQUAL(-9216, s.temperature.raw());
+	s.temperature = 1.0f / 8192; // rounds to nearest
+	ASSERT_EQUAL(1, s.temperature.raw());
+	s.temperature = 7.99f;
+	ASSERT_EQUAL(32727, s.temperature.raw());
+}
+void testFixedPointRawAndCombined(){
+	Sensor s{{0x0000u}};
+	s.level.raw(0x123u);
+	ASSERT_EQUAL_DELTA(18.1875, double(s.level), 0.0);
+	s.level = 255.9375;
+	ASSERT_EQUAL(0xFFF0u, s.word);
+	constexpr auto word = psbf::compose<Sensor>{}.set<&Sensor::level>(0.5).value();
+	static_assert(0x0080u == word);
+	psbf::modify(s, psbf::value(s.temperature, -1.5f));
+	ASSERT_EQUAL(0xE800u, s.word);
+}
+void testFixedPointValueConvertsLiterals(){
+	Sensor s{{0x0000u}};
+	psbf::modify(s, psbf::value(s.temperature, -1.5)); // double for a float field
+	ASSERT_EQUAL(0xE800u, s.word);
+	psbf::modify(s, psbf::value(s.level, 0.5f));       // float for a double field
+	ASSERT_EQUAL(0x0080u, s.word);
+	psbf::modify(s, psbf::value(s.level, 2));          // int
+	ASSERT_EQUAL(0x0200u, s.word);
+}
+template<typename FIXED>
+void checkConvertAllOnAllIsas(){
+	using word = typename FIXED::result_type;
+	auto const words = bulk::random_words<word>(203, 4u);
+	for (auto isa : bulk::all_isas) {
+		std::vector<float> reals(words.size());
+		psbf::convert_all<FIXED>(words, reals, isa);
+		for (std::size_t i = 0; i < words.size(); ++i) {
+			ASSERT_EQUAL_DELTA(FIXED::value_of(words[i]), reals[i], 0.0f);
+		}
+	}
+}
+void testConvertAll(){
+	checkConvertAllOnAllIsas<psbf::fixedpoint<psbf::sbits8<1,6>,3>>();
+	checkConvertAllOnAllIsas<psbf::fixedpoint<psbf::bits8<2,6>,5>>();
+	checkConvertAllOnAllIsas<decltype(Sensor::temperature)>();
+	checkConvertAllOnAllIsas<psbf::fixedpoint<psbf::bits16<3,12>,10>>();
+	checkConvertAllOnAllIsas<psbf::fixedpoint<psbf::sbits32<5,24>,16>>();
+	checkConvertAllOnAllIsas<psbf::fixedpoint<psbf::sbits32<0,32>,31>>();
+	checkConvertAllOnAllIsas<psbf::fixedpoint<psbf::bits32<0,32>,8>>(); // scalar only
+	checkConvertAllOnAllIsas<psbf::fixedpoint<psbf::sbits64<20,40>,20>>(); // scalar only
+}
+}
+
+namespace layouts {
+union Ctrl {
+	psbf::allbits32 word;
+	psbf::bits32<0,2> mode;
+	psbf::flag32<2> enable;
+	psbf::bits32<3,5> divider;
+	psbf::bits32<16,16> count;
+};
+using CtrlLayout = psbf::layout<decltype(Ctrl::mode), decltype(Ctrl::enable), decltype(Ctrl::divider), decltype(Ctrl::count)>;
+static_assert(0xffff'00ffu == CtrlLayout::all_fields_mask);
+static_assert(0x0000'ff00u == CtrlLayout::reserved_mask);
+static_assert(! CtrlLayout::complete);
+static_assert(psbf::layout<decltype(TestField32::firstnibble), decltype(TestField32::fourthbit), decltype(TestField32::threebits),
+		decltype(TestField32::secondbyte), decltype(TestField32::ashort)>::complete);
+static_assert(CtrlLayout::valid(0xffff'00ffu) && ! CtrlLayout::valid(0x0000'0100u));
+void testLayoutWordSetsAllFields(){
+	constexpr auto word = CtrlLayout::word(psbf::fieldvalue<decltype(Ctrl::count)>{0xABCDu},
+			psbf::fieldvalue<decltype(Ctrl::mode)>{3u},
+			psbf::fieldvalue<decltype(Ctrl::enable)>{false},
+			psbf::fieldvalue<decltype(Ctrl::divider)>{0x11u});
+	static_assert(0xABCD'008Bu == word);
+}
+void testLayoutStoreWritesWithoutRead(){
+	Ctrl volatile ctrl{{0xffff'ffffu}};
+	CtrlLayout::store(ctrl, psbf::value(ctrl.mode, 1u), psbf::value(ctrl.enable, true),
+			psbf::value(ctrl.divider, 2u), psbf::value(ctrl.count, 0x1234u));
+	ASSERT_EQUAL(0x1234'0015u, ctrl.word);
+}
+void testLayoutStoreKeepsGivenReservedBits(){
+	Ctrl volatile ctrl{{0xffff'ffffu}};
+	CtrlLayout::store(ctrl, 0x5A5A'5A5Au, psbf::value(ctrl.mode, 1u), psbf::value(ctrl.enable, true),
+			psbf::value(ctrl.divider, 2u), psbf::value(ctrl.count, 0x1234u));
+	ASSERT_EQUAL(0x1234'5A15u, ctrl.word);
+	using BigEndianLow = psbf::layout<psbf::bits32_be<0,8>>; // reserved bits in stored byte order
+	static_assert(0xAB22'3344u == BigEndianLow::word(0x1122'3344u, psbf::fieldvalue<psbf::bits32_be<0,8>>{0xABu}));
+}
+void testModifyOfAllFieldsReplacesWord(){
+	TestField32 volatile var{{0xffff'ffffu}};
+	psbf::modify(var, psbf::value(var.firstnibble, 0x3u), psbf::value(var.threebits, 0x5u), psbf::value(var.fourthbit, 0u),
+			psbf::value(var.secondbyte, 0x12u), psbf::value(var.ashort, 0x3456u));
+	ASSERT_EQUAL(0x3456'12A3u, var.word);
+}
+}
+
+namespace accesspolicies {
+template<typename ACCESS=psbf::native_access>
+union Ctrl {
+	using access = ACCESS;
+	psbf::bitfield<0,32,uint32_t,ACCESS> word;
+	psbf::bitfield<0,4,uint32_t,ACCESS> mode;
+	psbf::bitfield<4,12,uint32_t,ACCESS> count;
+	psbf::bitfield<30,1,uint32_t,ACCESS,bool> done;
+	psbf::bitfield<31,1,uint32_t,ACCESS,bool> start;
+};
+void testPlainAccessBehavesLikeVolatile(){
+	Ctrl<psbf::plain_access<>> plain{{0xffu}}; // ordinary memory accessed through a volatile reference
+	Ctrl<psbf::plain_access<>> volatile &ctrl = plain;
+	ctrl.mode = 3u;
+	ctrl.start.set();
+	ASSERT_EQUAL(0x8000'00f3u, ctrl.word);
+	psbf::modify(ctrl, psbf::value(ctrl.count, 0x123u));
+	ASSERT_EQUAL(0x123u, ctrl.count);
+}
+void testInstrumentedAccessCountsLoadsAndStores(){
+	using access = psbf::instrumented_access<>;
+	Ctrl<access> volatile ctrl{};
+	access::reset();
+	ctrl.mode = 5u;
+	ASSERT_EQUAL(1u, access::loads);
+	ASSERT_EQUAL(1u, access::stores);
+	psbf::modify(ctrl, psbf::value(ctrl.count, 7u), psbf::value(ctrl.start, true));
+	auto const copy = psbf::snapshot(ctrl);
+	psbf::compose<Ctrl<access>>{}.set<&Ctrl<access>::mode>(1u).store(ctrl);
+	ASSERT_EQUAL(3u, access::loads);
+	ASSERT_EQUAL(3u, access::stores);
+	ASSERT_EQUAL(7u, copy.count);
+}
+void testWritingWholeWordFieldDoesNotRead(){
+	using access = psbf::instrumented_access<>;
+	Ctrl<access> volatile ctrl{};
+	access::reset();
+	ctrl.word = 0x8000'0001u;
+	ASSERT_EQUAL(0u, access::loads);
+	ASSERT_EQUAL(1u, access::stores);
+	ASSERT_EQUAL(1u, ctrl.mode);
+}
+void testSimulatedDeviceRunsHooks(){
+	using Reg = Ctrl<psbf::simulated_access<>>;
+	psbf::simulated_device dev{0x20, std::chrono::nanoseconds{100}};
+	dev.on_write(0x8, [](psbf::simulated_device &d, uint64_t word){
+		if (word & 0x8000'0000u) d.poke<uint32_t>(0x8, uint32_t((word & 0x0fffu) | 0x4000'0000u)); // start clears, done sets
+	});
+	unsigned polls{};
+	dev.on_read(0xc, [&polls](psbf::simulated_device &d){ d.poke<uint32_t>(0xc, ++polls); });
+	Reg volatile &ctrl = dev.at<Reg>(0x8);
+	Reg volatile &counter = dev.at<Reg>(0xc);
+	psbf::modify(ctrl, psbf::value(ctrl.mode, 2u), psbf::value(ctrl.start, true));
+	ASSERT(ctrl.done);
+	ASSERT(!ctrl.start);
+	ASSERT_EQUAL(2u, ctrl.mode);
+	ASSERT_EQUAL(1u, counter.word);
+	ASSERT_EQUAL(2u, psbf::snapshot(counter).word);
+	ASSERT_EQUAL(6u, dev.reads());
+	ASSERT_EQUAL(1u, dev.writes());
+	ASSERT_EQUAL(700, dev.busy().count());
+	Reg volatile outside{};
+	outside.mode = 1u;
+	ASSERT_EQUAL(1u, dev.writes());
+}
+void testSimulatedDeviceCountsAccessesOfAllThreads(){
+	using Reg = Ctrl<psbf::simulated_access<>>;
+	psbf::simulated_device dev{0x10};
+	Reg volatile &first = dev.at<Reg>(0x0);
+	Reg volatile &second = dev.at<Reg>(0x4);
+	std::thread writing{[&first]{ for (unsigned i = 0; i < 1000; ++i) first.word = i; }};
+	for (unsigned i = 0; i < 1000; ++i) second.word = i;
+	writing.join();
+	ASSERT_EQUAL(2000u, dev.writes());
+	ASSERT_EQUAL(999u, dev.peek<uint32_t>(0x4));
+}
+void testAtomicAccessReadsAndWritesFields(){
+	Ctrl<psbf::acq_rel_access> ctrl{{0xffu}};
+	ctrl.mode = 3u;
+	ctrl.start.set();
+	ASSERT_EQUAL(0x8000'00f3u, ctrl.word);
+	ASSERT(not ctrl.done.test_and_set());
+	psbf::modify(ctrl, psbf::value(ctrl.count, 0x123u), psbf::value(ctrl.start, false));
+	auto const copy = psbf::snapshot(ctrl);
+	ASSERT_EQUAL(0x123u, copy.count);
+	ASSERT(copy.done);
+	ASSERT(not copy.start);
+}
+void testAtomicAccessKeepsConcurrentWritesOfOtherFields(){
+	Ctrl<psbf::relaxed_access> ctrl{};
+	constexpr unsigned writes = 100'000;
+	std::atomic<bool> go{};
+	std::thread counting{[&ctrl, &go]{
+		while (! go) {}
+		for (unsigned i = 1; i <= writes; ++i) ctrl.count = i % 4096u;
+	}};
+	go = true;
+	for (unsigned i = 1; i <= writes; ++i) {
+		psbf::modify(ctrl, psbf::value(ctrl.mode, i % 16u), psbf::value(ctrl.done, i % 2u == 1u));
+	}
+	counting.join();
+	ASSERT_EQUAL(writes % 4096u, ctrl.count);
+	ASSERT_EQUAL(writes % 16u, ctrl.mode);
+	ASSERT(not ctrl.done);
+}
+}
+
+namespace accesscounts {
+void testAccessCountsAreSortedByTotal(){
+	psbf::reset_access_counts();
+	uint32_t reg{};
+	for (int i = 0; i < 3; ++i) psbf::detail::count_access(&reg, 32, 0xff0u, false);
+	psbf::detail::count_access(&reg, 32, 0xfu, true);
+	psbf::detail::count_access(&reg, 32, 0xff0u, true);
+	auto const counts = psbf::access_counts();
+	ASSERT_EQUAL(2u, counts.size());
+	ASSERT_EQUAL(4u, counts[0].from());
+	ASSERT_EQUAL(8u, counts[0].width());
+	ASSERT_EQUAL(3u, counts[0].reads);
+	ASSERT_EQUAL(1u, counts[0].writes);
+	ASSERT_EQUAL(0u, counts[1].from());
+	ASSERT_EQUAL(1u, counts[1].writes);
+	psbf::reset_access_counts();
+	ASSERT(psbf::access_counts().empty());
+}
+void testAccessCountsOfEndedThreadsAreMerged(){
+	psbf::reset_access_counts();
+	uint16_t reg{};
+	std::thread counting{[&reg]{ psbf::detail::count_access(&reg, 16, 0xffffu, true); }};
+	counting.join();
+	psbf::detail::count_access(&reg, 16, 0xffffu, true);
+	auto const counts = psbf::access_counts();
+	ASSERT_EQUAL(1u, counts.size());
+	ASSERT_EQUAL(2u, counts[0].writes);
+	psbf::reset_access_counts();
+}
+}
+
+namespace traces {
+void testTraceRecordsAreOrderedByTimestamp(){
+	psbf::reset_trace();
+	uint32_t reg{};
+	psbf::detail::trace_access(&reg, 4, 0xf0u, 0x30u, true);
+	std::thread tracing{[&reg]{ psbf::detail::trace_access(&reg, 4, 0xfu, 0x3u, false); }};
+	tracing.join();
+	auto const records = psbf::trace_records();
+	ASSERT_EQUAL(2u, records.size());
+	ASSERT(records[0].timestamp <= records[1].timestamp);
+	ASSERT(records[0].write());
+	ASSERT_EQUAL(reinterpret_cast<std::uintptr_t>(&reg), records[0].address());
+	ASSERT_EQUAL(4u, records[0].size());
+	ASSERT_EQUAL(0xf0u, records[0].mask);
+	ASSERT(not records[1].write());
+	ASSERT_EQUAL(0x3u, records[1].word);
+	psbf::reset_trace();
+	ASSERT(psbf::trace_records().empty());
+}
+void testTraceBuffersOfEndedThreadsAreReused(){
+	uint8_t reg{};
+	std::thread{[&reg]{ psbf::detail::trace_access(&reg, 1, 0xffu, 1u, true); }}.join();
+	auto const buffers = psbf::detail::trace_buffers::instance().size();
+	for (int i = 0; i < 10; ++i) {
+		std::thread{[&reg]{ psbf::detail::trace_access(&reg, 1, 0xffu, 2u, true); }}.join();
+	}
+	ASSERT_EQUAL(buffers, psbf::detail::trace_buffers::instance().size());
+	psbf::reset_trace();
+}
+void testTraceBufferCanBeReadWhileRecording(){
+	auto buffer = std::make_unique<psbf::detail::trace_buffer>();
+	std::atomic<bool> done{};
+	std::thread recording{[&buffer, &done]{
+		for (uint64_t i = 0; i < 4 * psbf::detail::trace_buffer::capacity; ++i) buffer->push({i, i, i, i});
+		done = true;
+	}};
+	bool consistent = true;
+	while (! done) {
+		auto const records = buffer->recorded();
+		for (std::size_t i = 0; i < records.size(); ++i) {
+			auto const &r = records[i];
+			consistent = consistent && r.location == r.timestamp && r.mask == r.timestamp && r.word == r.timestamp
+					&& r.timestamp == records.front().timestamp + i;
+		}
+	}
+	recording.join();
+	ASSERT(consistent);
+	ASSERT_EQUAL(psbf::detail::trace_buffer::capacity - 1, buffer->recorded().size());
+}
+void testSavedTraceLoadsEqual(){
+	std::vector<psbf::trace_record> const records{
+		{1u, 0x1000u | uint64_t{2} << 56 | psbf::trace_record::writebit, 0xffffu, 0x1234u},
+		{7u, 0x1008u | uint64_t{8} << 56, ~uint64_t{}, 0x8000'0000'0000'0001u}};
+	std::FILE *file = std::tmpfile();
+	psbf::save_trace(file, records);
+	std::rewind(file);
+	auto const loaded = psbf::load_trace(file);
+	std::fclose(file);
+	ASSERT_EQUAL(2u, loaded.size());
+	ASSERT_EQUAL(0x1000u, loaded[0].address());
+	ASSERT_EQUAL(2u, loaded[0].size());
+	ASSERT(loaded[0].write());
+	ASSERT_EQUAL(0x1234u, loaded[0].word);
+	ASSERT_EQUAL(7u, loaded[1].timestamp);
+	ASSERT_EQUAL(8u, loaded[1].size());
+	ASSERT_EQUAL(0x8000'0000'0000'0001u, loaded[1].word);
+}
+void testReplayReissuesAccessesToDevice(){
+	std::uintptr_t const base = 0x4000'0000u;
+	std::vector<psbf::trace_record> const records{
+		{1u, (base + 0x10u) | uint64_t{4} << 56, 0xfu, 0u},
+		{2u, (base + 0x10u) | uint64_t{4} << 56 | psbf::trace_record::writebit, 0xfu, 0x5u},
+		{3u, (base + 0x40u) | uint64_t{4} << 56, ~uint64_t{}, 0u}}; // outside of the device
+	psbf::simulated_device dev{0x20, std::chrono::nanoseconds{100}};
+	ASSERT_EQUAL(2u, psbf::replay(records, dev, base));
+	ASSERT_EQUAL(1u, dev.reads());
+	ASSERT_EQUAL(1u, dev.writes());
+	ASSERT_EQUAL(200, dev.busy().count());
+	ASSERT_EQUAL(0x5u, dev.peek<uint32_t>(0x10));
+}
+}
+
+namespace singlebits {
+void testSetClearToggleBit(){
+	TestField32 volatile field{};
+	field.fourthbit.set();
+	ASSERT_EQUAL(0x10u,field.word);
+	field.fourthbit.toggle();
+	ASSERT_EQUAL(0x0u,field.word);
+	field.fourthbit.toggle();
+	field.word = 0xffu;
+	field.fourthbit.clear();
+	ASSERT_EQUAL(0xefu,field.word);
+}
+void testTestAndSetReturnsPreviousBit(){
+	b8::TestField field{{0x0fu}};
+	ASSERT(not field.fourthbit.test_and_set());
+	ASSERT(field.fourthbit.test_and_set());
+	ASSERT_EQUAL(0x1fu,field.word);
+}
+constexpr unsigned constexprSetAndToggle(){
+	b16::TestField field{};
+	field.fourthbit.set();
+	field.fourthbit.toggle();
+	field.fourthbit.toggle();
+	return field.fourthbit;
+}
+static_assert(constexprSetAndToggle() == 1u);
+}
+
+namespace atomics {
+template<typename ACCESS=psbf::seq_cst_access>
+union SharedWord {
+	using access = ACCESS;
+	template<uint8_t from, uint8_t width>
+	using bf=psbf::atomic_bits64<from,width,ACCESS>;
+	bf<0,64> word;
+	bf<0,1> flag;
+	bf<1,15> counter;
+	bf<16,16> other;
+	bf<32,32> dword;
+};
+static_assert(not(std::is_copy_assignable_v<SharedWord<>> || std::is_copy_constructible_v<SharedWord<>>));
+static_assert(std::is_same_v<psbf::atomic_allbits64, decltype(SharedWord<>::word)>);
+
+void testAtomicFieldsStoreAndLoad(){
+	SharedWord<> shared{};
+	shared.flag = 1;
+	shared.counter = 0x1234u;
+	shared.dword = 0xDEAD'BEEFu;
+	ASSERT_EQUAL(0xDEAD'BEEF'0000'2469u, shared.word);
+	ASSERT_EQUAL(0x1234u, shared.counter);
+	shared.flag = 0;
+	ASSERT_EQUAL(0u, shared.flag);
+	ASSERT_EQUAL(0xDEAD'BEEF'0000'2468u, psbf::snapshot(shared).word);
+}
+void testConcurrentStoresToDifferentFieldsAreNotLost(){
+	SharedWord<psbf::relaxed_access> shared{};
+	constexpr unsigned rounds = 10'000;
+	std::thread t1{[&]{ for (unsigned i=1; i <= rounds; ++i) shared.counter = i; }};
+	std::thread t2{[&]{ for (unsigned i=1; i <= rounds; ++i) shared.other = i; }};
+	std::thread t3{[&]{ for (unsigned i=1; i <= rounds; ++i) shared.flag = i % 2; }};
+	t1.join(); t2.join(); t3.join();
+	ASSERT_EQUAL(rounds, shared.counter);
+	ASSERT_EQUAL(rounds, shared.other);
+	ASSERT_EQUAL(0u, shared.flag);
+}
+void testAtomicSingleBitOperations(){
+	SharedWord<psbf::acq_rel_access> shared{{0xffff'0000u}};
+	ASSERT(not shared.flag.test_and_set());
+	ASSERT(shared.flag.test_and_set());
+	shared.flag.toggle();
+	ASSERT_EQUAL(0xffff'0000u, shared.word);
+	shared.flag.set();
+	ASSERT_EQUAL(0xffff'0001u, shared.word);
+	shared.flag.clear();
+	ASSERT_EQUAL(0xffff'0000u, shared.word);
+}
+void testConcurrentSetAndClearOfDifferentBitsAreNotLost(){
+	SharedWord<psbf::relaxed_access> shared{};
+	constexpr unsigned rounds = 10'000;
+	std::thread setting{[&]{ for (unsigned i=0; i < rounds; ++i) { shared.flag.set(); shared.flag.clear(); } }};
+	for (unsigned i=0; i < rounds; ++i) shared.counter = i;
+	setting.join();
+	ASSERT_EQUAL(rounds - 1u, shared.counter);
+	ASSERT_EQUAL(0u, shared.flag);
+}
+}
+
 namespace demonstration{
 	union MyReg16 {
 		template<uint8_t from, uint8_t width>
@@ -318,6 +1327,81 @@ bool runAllTests(int argc, char const *argv[]) {
 	s.push_back(CUTE(b8::testWritingBitInAllSetBitsClearsBits));
 	s.push_back(CUTE(b8::testWritingBitsInAllClearBitsSetsBits));
 	s.push_back(CUTE(b8::testWritingMultipleFieldsInAllClearBitsSetsBits));
+	s.push_back(CUTE(batched::testModifySetsAllFieldsAtOnce));
+	s.push_back(CUTE(batched::testModifyKeepsOtherFields));
+	s.push_back(CUTE(batched::testModifySingleField));
+	s.push_back(CUTE(batched::testModifyChecksFieldsOfUnion));
+	s.push_back(CUTE(composing::testComposeIsConstexpr));
+	s.push_back(CUTE(composing::testComposeStoreDoesNotKeepOldBits));
+	s.push_back(CUTE(composing::testComposeStartsFromResetValue));
+	s.push_back(CUTE(snapshots::testSnapshotCopiesAllFields));
+	s.push_back(CUTE(snapshots::testSnapshotIsNotAffectedByLaterWrites));
+	s.push_back(CUTE(shadows::testShadowWritesOnlyOnFlush));
+	s.push_back(CUTE(shadows::testCleanShadowDoesNotFlush));
+	s.push_back(CUTE(shadows::testShadowSetsValuesOfRegisterOrCopy));
+	s.push_back(CUTE(shadows::testShadowReloadDiscardsChanges));
+	s.push_back(CUTE(registerblocks::testRegisterBlockAccessesRegistersAtOffsets));
+	s.push_back(CUTE(registerblocks::testRegisterBlockSaveAndRestore));
+	s.push_back(CUTE(registerblocks::testRegisterBlockRestoreChangedWritesOnlyDifferences));
+	s.push_back(CUTE(packed::testPackedValuesStraddleWords));
+	s.push_back(CUTE(packed::testPackedSetKeepsNeighbours));
+	s.push_back(CUTE(packed::testPackedFillClearsUnusedBits));
+	s.push_back(CUTE(packed::testPackedIteratorsAndPushBack));
+	s.push_back(CUTE(bulk::testExtractAll8));
+	s.push_back(CUTE(bulk::testExtractAll16));
+	s.push_back(CUTE(bulk::testExtractAll32));
+	s.push_back(CUTE(bulk::testExtractAll64));
+	s.push_back(CUTE(bulk::testInsertAll));
+	s.push_back(CUTE(scatteredfields::testScatteredReadCombinesSlices));
+	s.push_back(CUTE(scatteredfields::testScatteredWriteSplitsValue));
+	s.push_back(CUTE(scatteredfields::testScatteredWithModify));
+	s.push_back(CUTE(wireviews::testWireViewReadsBigEndianAtUnalignedPosition));
+	s.push_back(CUTE(wireviews::testWireViewWritesBigEndian));
+	s.push_back(CUTE(wireviews::testWireViewLittleEndian));
+	s.push_back(CUTE(byteorders::testBigEndianFieldsAreStoredSwapped));
+	s.push_back(CUTE(byteorders::testBigEndianReadFromRawWord));
+	s.push_back(CUTE(byteorders::testBigEndianModifyAndCompose));
+	s.push_back(CUTE(widefields::testWideFieldStraddlingWordsIsRead));
+	s.push_back(CUTE(widefields::testWideFieldWriteTouchesOnlyItsBits));
+	s.push_back(CUTE(widefields::testWideFieldWiderThan64Bits));
+	s.push_back(CUTE(bitstreams::testBitStreamPacksWithoutPadding));
+	s.push_back(CUTE(bitstreams::testBitStreamRoundTrip));
+	s.push_back(CUTE(bitstreams::testBitStreamFieldsOfUnion));
+	s.push_back(CUTE(signedfields::testSignedFieldSignExtends));
+	s.push_back(CUTE(signedfields::testSignedFieldAssignKeepsOtherBits));
+	s.push_back(CUTE(signedfields::testSignedFieldsCombined));
+	s.push_back(CUTE(typedfields::testEnumFieldReadsAndWritesEnum));
+	s.push_back(CUTE(typedfields::testEnumWithoutUnderlyingTypeIsUnsigned));
+	s.push_back(CUTE(typedfields::testFlagFieldIsBool));
+	s.push_back(CUTE(typedfields::testTypedFieldsCombined));
+	s.push_back(CUTE(fixedpoints::testFixedPointReadWrite));
+	s.push_back(CUTE(fixedpoints::testFixedPointRawAndCombined));
+	s.push_back(CUTE(fixedpoints::testFixedPointValueConvertsLiterals));
+	s.push_back(CUTE(fixedpoints::testConvertAll));
+	s.push_back(CUTE(layouts::testLayoutWordSetsAllFields));
+	s.push_back(CUTE(layouts::testLayoutStoreWritesWithoutRead));
+	s.push_back(CUTE(layouts::testLayoutStoreKeepsGivenReservedBits));
+	s.push_back(CUTE(layouts::testModifyOfAllFieldsReplacesWord));
+	s.push_back(CUTE(accesspolicies::testPlainAccessBehavesLikeVolatile));
+	s.push_back(CUTE(accesspolicies::testInstrumentedAccessCountsLoadsAndStores));
+	s.push_back(CUTE(accesspolicies::testWritingWholeWordFieldDoesNotRead));
+	s.push_back(CUTE(accesspolicies::testSimulatedDeviceRunsHooks));
+	s.push_back(CUTE(accesspolicies::testSimulatedDeviceCountsAccessesOfAllThreads));
+	s.push_back(CUTE(accesspolicies::testAtomicAccessReadsAndWritesFields));
+	s.push_back(CUTE(accesspolicies::testAtomicAccessKeepsConcurrentWritesOfOtherFields));
+	s.push_back(CUTE(accesscounts::testAccessCountsAreSortedByTotal));
+	s.push_back(CUTE(accesscounts::testAccessCountsOfEndedThreadsAreMerged));
+	s.push_back(CUTE(traces::testTraceRecordsAreOrderedByTimestamp));
+	s.push_back(CUTE(traces::testTraceBuffersOfEndedThreadsAreReused));
+	s.push_back(CUTE(traces::testTraceBufferCanBeReadWhileRecording));
+	s.push_back(CUTE(traces::testSavedTraceLoadsEqual));
+	s.push_back(CUTE(traces::testReplayReissuesAccessesToDevice));
+	s.push_back(CUTE(singlebits::testSetClearToggleBit));
+	s.push_back(CUTE(singlebits::testTestAndSetReturnsPreviousBit));
+	s.push_back(CUTE(atomics::testAtomicFieldsStoreAndLoad));
+	s.push_back(CUTE(atomics::testConcurrentStoresToDifferentFieldsAreNotLost));
+	s.push_back(CUTE(atomics::testAtomicSingleBitOperations));
+	s.push_back(CUTE(atomics::testConcurrentSetAndClearOfDifferentBitsAreNotLost));
 	cute::xml_file_opener xmlfile(argc, argv);
 	cute::xml_listener<cute::ide_listener<>> lis(xmlfile.out);
 	auto runner = cute::makeRunner(lis, argc, argv);